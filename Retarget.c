@@ -23,8 +23,12 @@
 
 #ifdef __RTGT_UART 
 	#include "uart.h"
+	#include "rtos.h"
 	#define PORT_NUM 0
 	#define BAUD_RATE 9600
+	#ifndef LINE_SIZE
+	#define LINE_SIZE 80
+	#endif
 #endif
 
 #if !defined( __RTGT_GLCD ) && !defined(__RTGT_UART)
@@ -44,6 +48,48 @@ volatile uint8_t glcd_init_called = 0;
 #ifdef __RTGT_UART
 //A switch varaible to see if the init is called.
 volatile uint8_t uart_init_called = 0;
+
+//One line buffer per task, so printf from different tasks never
+//interleaves within a line and a task only pays for copying its
+//characters; whole lines go to the UART Tx ring. Not for use from
+//interrupt handlers, which would write into the running task's line.
+static uint8_t lineBuf[RTOS_MAX_TASKS][LINE_SIZE];
+static uint32_t lineLen[RTOS_MAX_TASKS];
+
+static void uartStart( void ) {
+
+	uint32_t primask;
+
+	if ( uart_init_called != 0 )
+		return;
+	//two tasks may get here at once; only one may init the port
+	primask = enterCritical();
+	if ( uart_init_called == 0 ) {
+		UARTInit(PORT_NUM, BAUD_RATE);
+		uart_init_called = 1;
+	}
+	exitCritical(primask);
+}
+
+static void lineFlush( void ) {
+
+	//before init() main is the only code running and becomes task 0
+	uint32_t t = currentTask ? currentTask->taskID : 0;
+
+	if ( lineLen[t] != 0 ) {
+		UARTSendBlocking(PORT_NUM, lineBuf[t], lineLen[t]);
+		lineLen[t] = 0;
+	}
+}
+
+static void linePut( uint8_t c ) {
+
+	uint32_t t = currentTask ? currentTask->taskID : 0;
+
+	if ( lineLen[t] == LINE_SIZE )
+		lineFlush();
+	lineBuf[t][lineLen[t]++] = c;
+}
 #endif
 
 /*----------------------------------------------------------------------------
@@ -61,18 +107,15 @@ int sendchar( int c ) {
 	#endif
 
 	#ifdef __RTGT_UART
-
-	//call init_scroll if it is not called
-	//Warning, this is not a thread safe code
-	if ( uart_init_called == 0 ) {
-		uart_init_called = 1;
-		UARTInit(PORT_NUM, BAUD_RATE);
-	}
-
+	uartStart();
 	#endif
 	
 	if ( c == '\r' || c == '\n' ) {
-		#if defined( __RTGT_UART ) || defined( __DBG_ITM )
+		#if defined( __RTGT_UART )
+			linePut( 0x0D );
+			linePut( 0x0A );
+			lineFlush();
+		#elif defined( __DBG_ITM )
 			UARTSendChar( PORT_NUM, 0x0D );
 			UARTSendChar( PORT_NUM, 0x0A );
 		#endif
@@ -81,7 +124,9 @@ int sendchar( int c ) {
 			CharAppend('\n');
 		#endif
 	} else {
-		#if defined(__RTGT_UART) || defined(__DBG_ITM)
+		#if defined(__RTGT_UART)
+			linePut(c);
+		#elif defined(__DBG_ITM)
 			UARTSendChar(PORT_NUM, c);
 		#endif
 		#ifdef __RTGT_GLCD
@@ -99,13 +144,9 @@ Read character from Serial Port   (blocking read)
 int getkey( void ) {
 
 	#ifdef __RTGT_UART
-	//call UARTInit if it is not called
-	//Warning, this is not a thread safe code
-
-	if ( uart_init_called == 0 ) {
-		uart_init_called = 1;
-		UARTInit(PORT_NUM, BAUD_RATE);
-	}
+	uartStart();
+	//a prompt without a newline should be visible before we block
+	lineFlush();
 	#endif
 	
 	#if defined( __RTGT_UART ) || defined( __DBG_ITM )
@@ -131,6 +172,10 @@ int fgetc( FILE *f ) {
 	int ch = getkey();
 
 	sendchar( ch );
+	#ifdef __RTGT_UART
+	//echo now, not at the end of the line
+	lineFlush();
+	#endif
 
 	return ch;
 }
@@ -2,17 +2,96 @@
  * context switch implementation.
  * @author Andrew Morton, 2018
  */
+#include <stddef.h>
 #include "context.h"
+#include "rtos.h"
+#include "trace.h"
 
-__asm uint32_t storeContext(void) {
-	MRS		R0,PSP
-	STMFD	R0!,{R4-R11}
-	BX		LR
-}
+/*
+ * Saves currentTask, switches to nextTask and restores it in one pass,
+ * with interrupts masked so nextTask cannot change half way through.
+ * A TASK_NOFRAME task has no R4-R11 on its stack: nothing is saved when
+ * it leaves and startFrame() gives it a fresh frame when it comes in.
+ * With RTOS_STACK_GUARD the MPU guard region follows the incoming task.
+ * With RTOS_CPU_STATS the outgoing task is charged for its run first.
+ * With RTOS_TRACE the switch is recorded before it happens.
+ */
+__asm void PendSV_Handler(void) {
+	PRESERVE8
+
+	CPSID	I
+#ifdef RTOS_BENCH
+	LDR		R0, =0xE0001004				; DWT->CYCCNT
+	LDR		R0, [R0]
+	LDR		R1, =__cpp(&switchStart)
+	STR		R0, [R1]
+#endif
+#ifdef RTOS_CPU_STATS
+	PUSH	{R0, LR}
+	BL		__cpp(switchAccount)
+	POP		{R0, LR}
+#endif
+#ifdef RTOS_TRACE
+	PUSH	{R0, LR}
+	BL		__cpp(traceSwitch)
+	POP		{R0, LR}
+#endif
 
-__asm void restoreContext(uint32_t sp) {
-	LDMFD	R0!,{R4-R11}
-	MSR		PSP,R0
+	LDR		R3, =__cpp(&currentTask)
+	LDR		R1, [R3]
+	LDRB	R2, [R1, #__cpp(offsetof(TCB_t, flags))]
+	TST		R2, #__cpp(TASK_NOFRAME)
+	BNE		saved
+	MRS		R0, PSP
+	STMDB	R0!, {R4-R11}
+	STR		R0, [R1, #__cpp(offsetof(TCB_t, taskSP))]
+saved
+	; a blocked task stays waiting, a preempted one goes back to ready
+	LDRB	R2, [R1, #__cpp(offsetof(TCB_t, state))]
+	CMP		R2, #__cpp(running)
+	ITT		EQ
+	MOVEQ	R2, #__cpp(ready)
+	STRBEQ	R2, [R1, #__cpp(offsetof(TCB_t, state))]
+
+	LDR		R2, =__cpp(&nextTask)
+	LDR		R1, [R2]
+	STR		R1, [R3]
+#ifdef RTOS_STACK_GUARD
+	; move MPU region 7 to the bottom of the incoming task's stack
+	LDR		R0, [R1, #__cpp(offsetof(TCB_t, taskBase))]
+	LDR		R2, [R1, #__cpp(offsetof(TCB_t, stackSize))]
+	SUB		R0, R0, R2
+	ORR		R0, R0, #0x17				; VALID, region 7
+	LDR		R2, =0xE000ED9C				; MPU->RBAR
+	STR		R0, [R2]
+	DSB									; the region has moved before
+	ISB									; the task runs
+#endif
+	MOV		R2, #__cpp(running)
+	STRB	R2, [R1, #__cpp(offsetof(TCB_t, state))]
+	LDRB	R2, [R1, #__cpp(offsetof(TCB_t, flags))]
+	TST		R2, #__cpp(TASK_NOFRAME)
+	BNE		start
+	LDR		R0, [R1, #__cpp(offsetof(TCB_t, taskSP))]
+	LDMIA	R0!, {R4-R11}
+	MSR		PSP, R0
+done
+#ifdef RTOS_BENCH
+	PUSH	{R0, LR}
+	BL		__cpp(switchTimed)
+	POP		{R0, LR}
+#endif
+	CPSIE	I
 	BX		LR
-}
 
+start
+	; first run or a new activation: the hardware frame is all it needs
+	PUSH	{R0, LR}
+	MOV		R0, R1
+	BL		__cpp(startFrame)
+	POP		{R1, LR}
+	MSR		PSP, R0
+	B		done
+
+	ALIGN
+}
@@ -7,8 +7,7 @@
 
 #include <stdint.h>
 
-uint32_t storeContext(void);
-void restoreContext(uint32_t sp);
+void PendSV_Handler(void);
 
 #endif
 
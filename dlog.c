@@ -0,0 +1,104 @@
+/*
+ * Deferred binary logging. Writers only copy a few words into a shared
+ * buffer with interrupts off, so DLOGn() is cheap enough for hot paths
+ * and interrupt handlers; dlogTask() ships the records out at low
+ * priority. A full buffer drops the new record and the next one that
+ * fits carries the count.
+ */
+
+#include "dlog.h"
+#ifndef DLOG_ITM
+#include "uart.h"
+#endif
+
+#define DLOG_MASK	(DLOG_BUFSIZE - 1)
+
+uint32_t dlogBuf[DLOG_BUFSIZE];
+volatile uint32_t dlogHead;	// written by dlogWrite with interrupts off
+volatile uint32_t dlogTail;	// written by dlogFlush only
+uint8_t dlogDropped;
+
+void dlogInit(void){
+	// timestamps come from the cycle counter; leave it running if
+	// init() already started it
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#ifndef DLOG_ITM
+	UARTInit(DLOG_PORT, DLOG_BAUD);
+#endif
+}
+
+void dlogWrite(const char *fmt, uint32_t nargs, uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+	uint32_t args[4];
+	uint32_t primask, head, i;
+
+	args[0] = a;
+	args[1] = b;
+	args[2] = c;
+	args[3] = d;
+
+	primask = enterCritical();
+	head = dlogHead;
+	if (DLOG_BUFSIZE - (head - dlogTail) < 4 + nargs) {
+		if (dlogDropped != 0xFF)
+			dlogDropped++;
+		exitCritical(primask);
+		return;
+	}
+	dlogBuf[head++ & DLOG_MASK] = (DLOG_MAGIC << 16) | (nargs << 8) | dlogDropped;
+	dlogBuf[head++ & DLOG_MASK] = (uint32_t)fmt;
+	dlogBuf[head++ & DLOG_MASK] = tickNow();
+	dlogBuf[head++ & DLOG_MASK] = DWT->CYCCNT;
+	for (i = 0; i < nargs; i++) {
+		dlogBuf[head++ & DLOG_MASK] = args[i];
+	}
+	dlogDropped = 0;
+	__DMB();	// record before index
+	dlogHead = head;
+	exitCritical(primask);
+}
+
+// send everything recorded so far; returns the number of words sent.
+// only one task may flush
+uint32_t dlogFlush(void){
+	uint32_t tail = dlogTail;
+	uint32_t count = dlogHead - tail;
+	uint32_t n, sent = 0;
+
+	while (count != 0) {
+		// up to the end of the buffer, then from the start
+		n = DLOG_BUFSIZE - (tail & DLOG_MASK);
+		if (n > count)
+			n = count;
+#ifdef DLOG_ITM
+		{
+			uint32_t i;
+
+			// no debugger listening: throw the records away
+			if ((ITM->TCR & ITM_TCR_ITMENA_Msk) && (ITM->TER & (1UL << DLOG_ITM_PORT))) {
+				for (i = 0; i < n; i++) {
+					while (ITM->PORT[DLOG_ITM_PORT].u32 == 0);
+					ITM->PORT[DLOG_ITM_PORT].u32 = dlogBuf[(tail + i) & DLOG_MASK];
+				}
+			}
+		}
+#else
+		// words go out in place, little-endian
+		UARTSendBlocking(DLOG_PORT, (uint8_t *)&dlogBuf[tail & DLOG_MASK], n * 4);
+#endif
+		tail += n;
+		count -= n;
+		sent += n;
+		__DMB();	// done with the words before they are handed back
+		dlogTail = tail;
+	}
+	return sent;
+}
+
+void dlogTask(void *args){
+	while (1) {
+		dlogFlush();
+		osDelay(DLOG_PERIOD);
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * deferred binary logging header file
+ *
+ * DLOGn(fmt, ...) records the address of its format string, msTicks, the
+ * cycle counter and n 32-bit arguments; nothing is formatted on the
+ * target. dlogTask() streams the records out and tools/dlog_decode.py
+ * turns them back into text using the strings in the .axf image. %s
+ * arguments must point at constant strings for the same reason.
+ *
+ * record: header (DLOG_MAGIC, argument count, records dropped before
+ * this one), format address, msTicks, DWT->CYCCNT, arguments
+ */
+#ifndef __dlog_h
+#define __dlog_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+// words of record buffer, a power of two
+#ifndef DLOG_BUFSIZE
+#define DLOG_BUFSIZE	256
+#endif
+
+// UART port and rate dlogTask() writes to, away from printf on port 0;
+// define DLOG_ITM to use ITM stimulus port DLOG_ITM_PORT instead
+#ifndef DLOG_PORT
+#define DLOG_PORT	1
+#endif
+#ifndef DLOG_BAUD
+#define DLOG_BAUD	115200
+#endif
+#ifndef DLOG_ITM_PORT
+#define DLOG_ITM_PORT	1
+#endif
+
+// ticks dlogTask() sleeps between flushes
+#ifndef DLOG_PERIOD
+#define DLOG_PERIOD	10
+#endif
+
+#if DLOG_BUFSIZE & (DLOG_BUFSIZE - 1)
+#error "DLOG_BUFSIZE must be a power of two"
+#endif
+
+#define DLOG_MAGIC	0xD10Cu
+
+// format strings are kept together, out of the way of other constants
+#define DLOG_FMT(fmt) \
+	static const char dlogFmt[] __attribute__((section("dlog_fmt"))) = fmt
+
+#define DLOG0(fmt) \
+	do { DLOG_FMT(fmt); dlogWrite(dlogFmt, 0, 0, 0, 0, 0); } while (0)
+#define DLOG1(fmt, a) \
+	do { DLOG_FMT(fmt); dlogWrite(dlogFmt, 1, (uint32_t)(a), 0, 0, 0); } while (0)
+#define DLOG2(fmt, a, b) \
+	do { DLOG_FMT(fmt); dlogWrite(dlogFmt, 2, (uint32_t)(a), (uint32_t)(b), 0, 0); } while (0)
+#define DLOG3(fmt, a, b, c) \
+	do { DLOG_FMT(fmt); dlogWrite(dlogFmt, 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0); } while (0)
+#define DLOG4(fmt, a, b, c, d) \
+	do { DLOG_FMT(fmt); dlogWrite(dlogFmt, 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d)); } while (0)
+
+void dlogInit(void);
+void dlogWrite(const char *fmt, uint32_t nargs, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+uint32_t dlogFlush(void);
+void dlogTask(void *args);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Event flag groups: 32 flags a task can wait on in any or all
+ * combinations. Setting flags checks every waiter in one pass and wakes
+ * all that are satisfied, then reschedules once.
+ */
+
+#include "event.h"
+#include "trace.h"
+
+// what a blocked task waits for, on its stack; waitData points here
+typedef struct {
+	uint32_t mask;
+	uint8_t options;
+	uint32_t flags;		// group flags when the wait was satisfied
+} eventWait_t;
+
+static uint8_t eventSatisfied(uint32_t flags, uint32_t mask, uint8_t options){
+	if (options & OS_EVENT_ALL)
+		return (flags & mask) == mask;
+	return (flags & mask) != 0;
+}
+
+void osEventInit(osEvent_t *event, uint32_t flags){
+	event->flags = flags;
+	event->waiters.head = 0;
+}
+
+// wait for at most timeout ticks until the flags in mask satisfy options;
+// returns the group's flags at that moment, before any clearing, or 0 on
+// timeout
+uint32_t osEventWait(osEvent_t *event, uint32_t mask, uint8_t options, uint32_t timeout){
+	uint32_t primask;
+	uint32_t flags;
+	eventWait_t wait;
+
+	if (mask == 0)
+		return 0;
+
+	primask = enterCritical();
+	flags = event->flags;
+	if (eventSatisfied(flags, mask, options)) {
+		if (options & OS_EVENT_CLEAR)
+			event->flags &= ~mask;
+		exitCritical(primask);
+		return flags;
+	}
+	if (timeout == OS_NO_WAIT) {
+		exitCritical(primask);
+		return 0;
+	}
+
+	wait.mask = mask;
+	wait.options = options;
+	wait.flags = 0;
+	currentTask->waitData = &wait;
+	trace(TRACE_BLOCK, currentTask->taskID, event);
+	waitOn(&event->waiters, timeout);
+	exitCritical(primask);
+
+	// osEventSet() fills in wait.flags before waking us
+	return currentTask->waitResult ? wait.flags : 0;
+}
+
+// set flags and wake every waiter they satisfy; safe to call from
+// interrupt handlers. all waiters see the same flags, and the flags
+// they asked to clear go only after the pass
+void osEventSet(osEvent_t *event, uint32_t flags){
+	uint32_t primask = enterCritical();
+	uint32_t clear = 0;
+	TCB_t *tcb = event->waiters.head;
+	TCB_t *last, *next;
+	eventWait_t *wait;
+	uint8_t woken = 0;
+
+	trace(TRACE_EVENT_SET, traceTaskID(), event);
+	event->flags |= flags;
+	flags = event->flags;
+
+	if (tcb != 0) {
+		// waking a task reuses its links, so walk by saved pointers
+		last = tcb->prev;
+		do {
+			next = tcb->next;
+			wait = (eventWait_t *)tcb->waitData;
+			if (eventSatisfied(flags, wait->mask, wait->options)) {
+				wait->flags = flags;
+				if (wait->options & OS_EVENT_CLEAR)
+					clear |= wait->mask;
+				wakeTask(tcb, 1);
+				woken = 1;
+			}
+			if (tcb == last)
+				break;
+			tcb = next;
+		} while (1);
+	}
+
+	event->flags &= ~clear;
+	if (woken)
+		schedule();
+	exitCritical(primask);
+}
+
+void osEventClear(osEvent_t *event, uint32_t flags){
+	uint32_t primask = enterCritical();
+
+	event->flags &= ~flags;
+	exitCritical(primask);
+}
+
+uint32_t osEventGet(osEvent_t *event){
+	return event->flags;
+}
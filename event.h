@@ -0,0 +1,26 @@
+/*
+ * event flag group header file
+ */
+#ifndef __event_h
+#define __event_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+// osEventWait options
+#define OS_EVENT_ANY	0x00	// wake when any flag in the mask is set
+#define OS_EVENT_ALL	0x01	// wake when every flag in the mask is set
+#define OS_EVENT_CLEAR	0x02	// clear the mask's flags on the way out
+
+typedef struct {
+	volatile uint32_t flags;
+	waitList_t waiters;
+} osEvent_t;
+
+void osEventInit(osEvent_t *event, uint32_t flags);
+uint32_t osEventWait(osEvent_t *event, uint32_t mask, uint8_t options, uint32_t timeout);
+void osEventSet(osEvent_t *event, uint32_t flags);
+void osEventClear(osEvent_t *event, uint32_t flags);
+uint32_t osEventGet(osEvent_t *event);
+
+#endif
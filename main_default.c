@@ -7,131 +7,66 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
-#include "context.h"
+#include "rtos.h"
+#include "timer.h"
+#include "trace.h"
 
-#define SPBIT 0x02
-uint32_t msTicks = 0;
+osTimer_t led4Timer;
+osTimer_t led6Timer;
 
-void SysTick_Handler(void) {
-    msTicks++;
-	  SCB->ICSR |= (0x01 << 28);
-}
-
-typedef struct {
-	uint8_t taskID;
-	uint32_t taskBase;
-	uint32_t taskSP;
-	
-	enum states{
-		inactive,
-		waiting,
-		ready,
-		running
-	} state;
-	
-} TCB_t;
-
-TCB_t tcbList[6]; 
-typedef void (*rtosTaskFunc_t)(void *args);
-
-void PendSV_Handler(){
-	uint8_t i = 0;
-	// find running task
-	while (tcbList[i].state != running) {
-		i++;
-	}
-	
-	// find next ready task
-	uint8_t j = i;
-	while (tcbList[j].state != ready) {
-		j = (j+1)%6;
-	}
-	
-	// store registers to stack
-	tcbList[i].taskSP = storeContext();	  
-
-	// change states
-	tcbList[i].state = ready;
-	tcbList[j].state = running;
-
-	// push new task's stack contents to registers
-	restoreContext(tcbList[j].taskSP);
-}
-
-void init(void){	
-	// initialize TCBs
-	uint32_t * vectorTable = 0x0;
-	uint32_t mainStackBase = vectorTable[0];
-	
-	for (uint8_t i = 0; i < 6; i++){
-		tcbList[i].taskBase = (mainStackBase - 2048) - (1024*(5-i));
-		tcbList[i].taskSP = tcbList[i].taskBase;
-		tcbList[i].taskID = i;
-		tcbList[i].state = inactive;
-	}
-	
-	// 2) copy Main stack contents to process stack
-	uint32_t mainSP = __get_MSP();
-	for (uint32_t i = 0; i < 1024; i++){
-		*((uint32_t *)(tcbList[0].taskBase - i)) = *((uint32_t *)(mainStackBase - i));
-	}
-	tcbList[0].taskSP = tcbList[0].taskBase - (mainStackBase - mainSP);
-	tcbList[0].state = running;
+void led_toggle(void* s){
+	// arg is the pin of an LED on GPIO2
+	uint32_t bit = 1 << (uint32_t)s;
 
-	__set_MSP(mainStackBase);
-	__set_CONTROL(__get_CONTROL() | SPBIT);
-	__set_PSP(tcbList[0].taskSP);
+	if (LPC_GPIO2->FIOPIN & bit)
+		LPC_GPIO2->FIOCLR = bit;
+	else
+		LPC_GPIO2->FIOSET = bit;
 }
 
-uint8_t createTask(rtosTaskFunc_t funcPtr, void * args) {
-	int i = 1;
-
-	// find next empty stack
-	while(tcbList[i].taskSP != tcbList[i].taskBase) {
-		i++;
-		if (i >= 6)
-			return 0;
-	}
-	
-	// set it to ready to run
-	tcbList[i].state = ready;
-	
-	// PSR
-	tcbList[i].taskSP -= 4;
-	*((uint32_t *)tcbList[i].taskSP) = (uint32_t)0x01000000;
-	
-	// PC
-	tcbList[i].taskSP -= 4;
-	*((uint32_t *)tcbList[i].taskSP) = (uint32_t)funcPtr;
+#ifdef RTOS_BENCH
+#ifndef BENCH_SLICE
+#define BENCH_SLICE 10	// quantum for the load tasks; compare switch counts against 1
+#endif
 
-	// LR to R1
-	for (uint8_t x = 0; x < 5; x++) {
-		tcbList[i].taskSP -= 4;
-		*((uint32_t *)tcbList[i].taskSP) = (uint32_t)0x00;
-	}
-
-	// R0
-	tcbList[i].taskSP -= 4;
-	*((uint32_t *)tcbList[i].taskSP) = *(uint32_t *)args;
-
-	// R11 to R4
-	for (uint8_t x = 0; x < 8; x++) {
-		tcbList[i].taskSP -= 4;
-		*((uint32_t *)tcbList[i].taskSP) = (uint32_t)0x00;
+void load_task(void* s){
+	// CPU-bound work so equal-priority tasks contend for the CPU
+	volatile uint32_t n = 0;
+	while(1) {
+		n++;
 	}
-	
-	return 1;
 }
 
-void task_1(void* s){
-	// blink LED 6
+void bench_task(void* s){
+	// report context-switch cost once a second
+	rtosSwitchStats_t stats;
+	uint32_t wake = osTickCount();
 	while(1) {
-		LPC_GPIO2->FIOSET = 1 << 6;
-		for(int i=0; i<12000000; i++);
-		LPC_GPIO2->FIOCLR = 1 << 6;
-		for(int i=0; i<12000000; i++);
+		wake += 1000;
+		osDelayUntil(wake);
+		getSwitchStats(&stats);
+		printf("switches %u (%u avoided): last %u, min %u, max %u, avg %u cycles\n",
+			stats.count, switchesAvoided, stats.last, stats.min, stats.max,
+			(uint32_t)(stats.total / stats.count));
+	}
+}
+#endif
+
+#ifdef RTOS_CPU_STATS
+void print_top(void){
+	// one line per task with its share of the CPU since the last report
+	static const char *states[] = { "inactive", "waiting", "ready", "running" };
+	rtosTaskStats_t stats[RTOS_MAX_TASKS];
+	uint8_t n = getTaskStats(stats, RTOS_MAX_TASKS);
+
+	printf("task prio state     cpu%%   switches    Mcycles\n");
+	for (uint8_t i = 0; i < n; i++) {
+		printf("%4u %4u %-8s %3u.%u %10u %10u\n", stats[i].taskID, stats[i].priority,
+			states[stats[i].state], stats[i].load / 10, stats[i].load % 10,
+			stats[i].switches, (uint32_t)(stats[i].cycles / 1000000));
 	}
 }
+#endif
 
 int main(void) {
 	//initialize all LEDs
@@ -142,20 +77,30 @@ int main(void) {
 	LPC_GPIO2->FIOCLR |= 0x0000007C;
 	LPC_GPIO1->FIOCLR |= ((uint32_t)11<<28);
 
-	// initialize systick
-	SysTick_Config(SystemCoreClock/1000);
-	init();		// initialize stack for each task
+	init();		// initialize stack for each task and start systick
 	
-	// create new task
-	rtosTaskFunc_t p = task_1;
-	char *s = "test_param";
-	createTask(p, s);
+	// blink LEDs 4 and 6 from the timer service task
+	osTimerServiceStart();
+	osTimerInit(&led4Timer, led_toggle, (void *)4);
+	osTimerInit(&led6Timer, led_toggle, (void *)6);
+	osTimerStart(&led4Timer, 500, 500);
+	osTimerStart(&led6Timer, 500, 500);
+#ifdef RTOS_TRACE
+	// stream the kernel trace out at main's priority, below all the work
+	traceInit();
+	createTask(traceTask, 0, RTOS_MAIN_PRIORITY, RTOS_TIME_SLICE, 512, 0);
+#endif
+#ifdef RTOS_BENCH
+	createTask(bench_task, 0, RTOS_MAIN_PRIORITY + 1, RTOS_TIME_SLICE, 1024, 0);
+	createTask(load_task, 0, RTOS_MAIN_PRIORITY, BENCH_SLICE, 256, 0);
+	createTask(load_task, 0, RTOS_MAIN_PRIORITY, BENCH_SLICE, 256, 0);
+#endif
 	
-	// blink LED 4
+	// main has nothing left to do but report CPU use with RTOS_CPU_STATS
 	while(1) {
-		LPC_GPIO2->FIOSET = 1 << 4;
-		for(int i=0; i<12000000; i++);
-		LPC_GPIO2->FIOCLR = 1 << 4;
-		for(int i=0; i<12000000; i++);
+		osDelay(1000);
+#ifdef RTOS_CPU_STATS
+		print_top();
+#endif
 	}
 }
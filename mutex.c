@@ -0,0 +1,141 @@
+/*
+ * Recursive mutexes with priority inheritance. While a task waits on a
+ * mutex its owner, and the owner of any mutex that owner is waiting on,
+ * runs at least at the waiter's priority, so a middle-priority task
+ * cannot hold up the chain. Not for use from interrupt handlers.
+ */
+
+#include "mutex.h"
+#include "trace.h"
+
+// settle tcb at the highest of its own priority and that of the first
+// waiter on each mutex it still holds
+static void mutexRestorePriority(TCB_t *tcb){
+	uint8_t priority = tcb->basePriority;
+
+	for (osMutex_t *m = tcb->heldMutexes; m != 0; m = m->nextHeld) {
+		if (m->waiters.head != 0 && m->waiters.head->priority > priority)
+			priority = m->waiters.head->priority;
+	}
+	taskSetPriority(tcb, priority);
+}
+
+static void mutexTake(osMutex_t *mutex, TCB_t *tcb){
+	mutex->owner = tcb;
+	mutex->count = 1;
+	mutex->nextHeld = tcb->heldMutexes;
+	tcb->heldMutexes = mutex;
+}
+
+static void mutexDrop(osMutex_t *mutex){
+	osMutex_t **link = &mutex->owner->heldMutexes;
+
+	while (*link != mutex) {
+		link = &(*link)->nextHeld;
+	}
+	*link = mutex->nextHeld;
+	mutex->nextHeld = 0;
+	mutex->owner = 0;
+}
+
+void osMutexInit(osMutex_t *mutex){
+	mutex->owner = 0;
+	mutex->count = 0;
+	mutex->waiters.head = 0;
+	mutex->nextHeld = 0;
+}
+
+// lock, blocking for at most timeout ticks; returns 1 once the caller
+// owns the mutex and 0 on timeout. the owner may lock it again
+uint8_t osMutexLock(osMutex_t *mutex, uint32_t timeout){
+	uint32_t primask;
+	uint8_t result;
+
+	// before init() there is only one thread of execution
+	if (currentTask == 0)
+		return 1;
+
+	primask = enterCritical();
+	if (mutex->owner == 0) {
+		mutexTake(mutex, currentTask);
+		trace(TRACE_MUTEX_LOCK, currentTask->taskID, mutex);
+		exitCritical(primask);
+		return 1;
+	}
+	if (mutex->owner == currentTask) {
+		mutex->count++;
+		exitCritical(primask);
+		return 1;
+	}
+	if (timeout == OS_NO_WAIT) {
+		exitCritical(primask);
+		return 0;
+	}
+
+	// lend our priority down the chain of owners
+	for (osMutex_t *m = mutex; m != 0 && m->owner->priority < currentTask->priority; m = m->owner->waitMutex) {
+		taskSetPriority(m->owner, currentTask->priority);
+	}
+
+	currentTask->waitMutex = mutex;
+	trace(TRACE_BLOCK, currentTask->taskID, mutex);
+	waitOn(&mutex->waiters, timeout);
+	exitCritical(primask);
+
+	// back here once handed the mutex or timed out; wakeTask() has
+	// cleared waitMutex either way
+	primask = enterCritical();
+	result = currentTask->waitResult;
+	if (!result) {
+		// take back what we lent down the chain. an owner whose
+		// priority does not move passes nothing further on, which also
+		// ends the walk round a deadlocked cycle
+		for (osMutex_t *m = mutex; m != 0 && m->owner != 0; m = m->owner->waitMutex) {
+			uint8_t priority = m->owner->priority;
+
+			mutexRestorePriority(m->owner);
+			if (m->owner->priority == priority)
+				break;
+		}
+		schedule();
+	}
+	exitCritical(primask);
+
+	return result;
+}
+
+// unlock; the mutex goes straight to the highest-priority waiter and the
+// caller drops back from any priority it inherited. returns 0 if the
+// caller is not the owner
+uint8_t osMutexUnlock(osMutex_t *mutex){
+	uint32_t primask;
+	TCB_t *waiter;
+
+	if (currentTask == 0)
+		return 1;
+
+	primask = enterCritical();
+	if (mutex->owner != currentTask) {
+		exitCritical(primask);
+		return 0;
+	}
+	if (--mutex->count != 0) {
+		exitCritical(primask);
+		return 1;
+	}
+
+	mutexDrop(mutex);
+	trace(TRACE_MUTEX_UNLOCK, currentTask->taskID, mutex);
+	waiter = mutex->waiters.head;
+	if (waiter != 0) {
+		wakeTask(waiter, 1);
+		mutexTake(mutex, waiter);
+		// the new owner inherits from whoever is still waiting
+		mutexRestorePriority(waiter);
+	}
+	mutexRestorePriority(currentTask);
+	schedule();
+	exitCritical(primask);
+
+	return 1;
+}
@@ -0,0 +1,21 @@
+/*
+ * priority-inheritance mutex header file
+ */
+#ifndef __mutex_h
+#define __mutex_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+typedef struct osMutex {
+	TCB_t *owner;
+	uint32_t count;			// recursion depth
+	waitList_t waiters;
+	struct osMutex *nextHeld;	// owner's other mutexes
+} osMutex_t;
+
+void osMutexInit(osMutex_t *mutex);
+uint8_t osMutexLock(osMutex_t *mutex, uint32_t timeout);
+uint8_t osMutexUnlock(osMutex_t *mutex);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Fixed-block memory pools. The free list is kept in the free blocks
+ * themselves, so a pool costs no memory beyond its blocks and both
+ * alloc and free are a couple of pointer moves with interrupts off;
+ * they are safe to call from interrupt handlers. Blocks handed through
+ * a queue with osQueueSendPtr() are freed by whoever receives them.
+ */
+
+#include "pool.h"
+
+// buf holds OS_POOL_WORDS(blockSize, blocks) words
+void osPoolInit(osPool_t *pool, uint32_t *buf, uint32_t blockSize, uint32_t blocks){
+	uint32_t i;
+	uint8_t *block;
+
+	// every block must be able to hold the free-list link
+	if (blockSize < sizeof(void *))
+		blockSize = sizeof(void *);
+	blockSize = (blockSize + 3) & ~3u;
+
+	pool->base = (uint8_t *)buf;
+	pool->blockSize = blockSize;
+	pool->blocks = blocks;
+	pool->used = 0;
+	pool->maxUsed = 0;
+	pool->failed = 0;
+
+	// thread the blocks in address order
+	pool->freeList = 0;
+	for (i = blocks; i > 0; i--) {
+		block = pool->base + (i - 1) * blockSize;
+		*(void **)block = pool->freeList;
+		pool->freeList = block;
+	}
+}
+
+// returns a block, or 0 when the pool is empty
+void *osPoolAlloc(osPool_t *pool){
+	uint32_t primask = enterCritical();
+	void *block = pool->freeList;
+
+	if (block != 0) {
+		pool->freeList = *(void **)block;
+		if (++pool->used > pool->maxUsed)
+			pool->maxUsed = pool->used;
+	} else {
+		pool->failed++;
+	}
+	exitCritical(primask);
+
+	return block;
+}
+
+// returns 0, and leaves the pool alone, for a pointer that is not the
+// start of one of its blocks, or for a free of a block that cannot be in
+// use: with nothing allocated, or when it was the last block freed.
+// checking the whole free list would not be O(1), so other double frees
+// still corrupt the pool
+uint8_t osPoolFree(osPool_t *pool, void *block){
+	uint32_t offset = (uint8_t *)block - pool->base;
+	uint32_t primask;
+
+	if ((uint8_t *)block < pool->base || offset >= pool->blockSize * pool->blocks ||
+		offset % pool->blockSize != 0)
+		return 0;
+
+	primask = enterCritical();
+	if (pool->used == 0 || block == pool->freeList) {
+		exitCritical(primask);
+		return 0;
+	}
+	*(void **)block = pool->freeList;
+	pool->freeList = block;
+	pool->used--;
+	exitCritical(primask);
+
+	return 1;
+}
+
+void osPoolGetStats(osPool_t *pool, osPoolStats_t *stats){
+	uint32_t primask = enterCritical();
+
+	stats->blocks = pool->blocks;
+	stats->used = pool->used;
+	stats->maxUsed = pool->maxUsed;
+	stats->failed = pool->failed;
+	exitCritical(primask);
+}
@@ -0,0 +1,35 @@
+/*
+ * fixed-block memory pool header file
+ */
+#ifndef __pool_h
+#define __pool_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+// storage for count blocks of size bytes, word aligned
+#define OS_POOL_WORDS(size, count)	((((size) + 3) / 4) * (count))
+
+typedef struct {
+	void *freeList;		// free blocks, linked through their first word
+	uint8_t *base;
+	uint32_t blockSize;	// rounded up to a whole number of words
+	uint32_t blocks;
+	uint32_t used;
+	uint32_t maxUsed;	// high-water mark of used
+	uint32_t failed;	// allocations refused because the pool was empty
+} osPool_t;
+
+typedef struct {
+	uint32_t blocks;
+	uint32_t used;
+	uint32_t maxUsed;
+	uint32_t failed;
+} osPoolStats_t;
+
+void osPoolInit(osPool_t *pool, uint32_t *buf, uint32_t blockSize, uint32_t blocks);
+void *osPoolAlloc(osPool_t *pool);
+uint8_t osPoolFree(osPool_t *pool, void *block);
+void osPoolGetStats(osPool_t *pool, osPoolStats_t *stats);
+
+#endif
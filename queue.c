@@ -0,0 +1,126 @@
+/*
+ * Fixed-size message queues. Messages are copied in and out with
+ * interrupts off, so large ones should go by pointer with
+ * osQueueSendPtr(). When a task is already blocked on the other end the
+ * message moves straight between the two tasks' buffers, so a woken
+ * task never finds its message taken by someone else.
+ */
+
+#include <string.h>
+#include "queue.h"
+#include "trace.h"
+
+// length may be 0, in which case every send waits for a receiver
+void osQueueInit(osQueue_t *queue, void *buf, uint32_t msgSize, uint32_t length){
+	queue->buf = (uint8_t *)buf;
+	queue->msgSize = msgSize;
+	queue->length = length;
+	queue->count = 0;
+	queue->head = 0;
+	queue->tail = 0;
+	queue->senders.head = 0;
+	queue->receivers.head = 0;
+}
+
+static void queuePut(osQueue_t *queue, const void *msg){
+	memcpy(queue->buf + queue->head * queue->msgSize, msg, queue->msgSize);
+	if (++queue->head == queue->length)
+		queue->head = 0;
+	queue->count++;
+}
+
+static void queueGet(osQueue_t *queue, void *msg){
+	memcpy(msg, queue->buf + queue->tail * queue->msgSize, queue->msgSize);
+	if (++queue->tail == queue->length)
+		queue->tail = 0;
+	queue->count--;
+}
+
+// copy msg into the queue, blocking for at most timeout ticks while it
+// is full; returns 1 once sent and 0 on timeout. with OS_NO_WAIT it is
+// safe to call from interrupt handlers
+uint8_t osQueueSend(osQueue_t *queue, const void *msg, uint32_t timeout){
+	uint32_t primask = enterCritical();
+	TCB_t *rx = queue->receivers.head;
+
+	trace(TRACE_QUEUE_SEND, traceTaskID(), queue);
+
+	// a receiver only waits on an empty queue, so it is next in line
+	if (rx != 0) {
+		memcpy(rx->waitData, msg, queue->msgSize);
+		wakeTask(rx, 1);
+		schedule();
+		exitCritical(primask);
+		return 1;
+	}
+	if (queue->count < queue->length) {
+		queuePut(queue, msg);
+		exitCritical(primask);
+		return 1;
+	}
+	if (timeout == OS_NO_WAIT) {
+		exitCritical(primask);
+		return 0;
+	}
+
+	// a receiver copies the message from here when it makes room
+	currentTask->waitData = (void *)msg;
+	trace(TRACE_BLOCK, currentTask->taskID, queue);
+	waitOn(&queue->senders, timeout);
+	exitCritical(primask);
+
+	return currentTask->waitResult;
+}
+
+// take the oldest message into msg, blocking for at most timeout ticks
+// while the queue is empty; returns 1 once received and 0 on timeout
+uint8_t osQueueReceive(osQueue_t *queue, void *msg, uint32_t timeout){
+	uint32_t primask = enterCritical();
+	TCB_t *tx = queue->senders.head;
+
+	trace(TRACE_QUEUE_RECEIVE, traceTaskID(), queue);
+
+	if (queue->count > 0) {
+		queueGet(queue, msg);
+		// the queue was full: the first blocked sender takes the slot
+		if (tx != 0) {
+			queuePut(queue, tx->waitData);
+			wakeTask(tx, 1);
+			schedule();
+		}
+		exitCritical(primask);
+		return 1;
+	}
+	// only with length 0: take the message straight from the sender
+	if (tx != 0) {
+		memcpy(msg, tx->waitData, queue->msgSize);
+		wakeTask(tx, 1);
+		schedule();
+		exitCritical(primask);
+		return 1;
+	}
+	if (timeout == OS_NO_WAIT) {
+		exitCritical(primask);
+		return 0;
+	}
+
+	// a sender copies its message here
+	currentTask->waitData = msg;
+	trace(TRACE_BLOCK, currentTask->taskID, queue);
+	waitOn(&queue->receivers, timeout);
+	exitCritical(primask);
+
+	return currentTask->waitResult;
+}
+
+uint32_t osQueueCount(osQueue_t *queue){
+	return queue->count;
+}
+
+uint8_t osQueueSendPtr(osQueue_t *queue, void *ptr, uint32_t timeout){
+	return osQueueSend(queue, &ptr, timeout);
+}
+
+uint8_t osQueueReceivePtr(osQueue_t *queue, void **ptr, uint32_t timeout){
+	return osQueueReceive(queue, ptr, timeout);
+}
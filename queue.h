@@ -0,0 +1,32 @@
+/*
+ * message queue header file
+ */
+#ifndef __queue_h
+#define __queue_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+typedef struct {
+	uint8_t *buf;		// length slots of msgSize bytes
+	uint32_t msgSize;
+	uint32_t length;
+	volatile uint32_t count;
+	uint32_t head;		// next slot to fill
+	uint32_t tail;		// next slot to empty
+	waitList_t senders;	// blocked while the queue is full
+	waitList_t receivers;	// blocked while it is empty
+} osQueue_t;
+
+void osQueueInit(osQueue_t *queue, void *buf, uint32_t msgSize, uint32_t length);
+uint8_t osQueueSend(osQueue_t *queue, const void *msg, uint32_t timeout);
+uint8_t osQueueReceive(osQueue_t *queue, void *msg, uint32_t timeout);
+uint32_t osQueueCount(osQueue_t *queue);
+
+// zero-copy: the queue carries only a pointer to the message, typically
+// a block from an osPool_t, which the receiver then owns and frees.
+// the queue's msgSize must be sizeof(void *)
+uint8_t osQueueSendPtr(osQueue_t *queue, void *ptr, uint32_t timeout);
+uint8_t osQueueReceivePtr(osQueue_t *queue, void **ptr, uint32_t timeout);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Lock-free single-producer/single-consumer byte ring.
+ *
+ * head is only written by the producer and tail only by the consumer,
+ * so an interrupt handler and a task can share a ring without a lock
+ * or a read-modify-write on shared state. Both indices run freely and
+ * wrap at 2^32; head - tail is the fill level, and the size must be a
+ * power of two so that the mask picks the slot.
+ */
+#ifndef __ringbuf_h
+#define __ringbuf_h
+
+#include <LPC17xx.h>
+#include <stdint.h>
+
+typedef struct {
+	volatile uint32_t head;		// next slot to write, producer only
+	volatile uint32_t tail;		// next slot to read, consumer only
+	uint32_t mask;			// size - 1
+	uint8_t *buf;
+} ringBuf_t;
+
+static __inline void ringInit(ringBuf_t *rb, uint8_t *buf, uint32_t size){
+	rb->head = 0;
+	rb->tail = 0;
+	rb->mask = size - 1;
+	rb->buf = buf;
+}
+
+static __inline uint32_t ringCount(ringBuf_t *rb){
+	return rb->head - rb->tail;
+}
+
+static __inline uint32_t ringSpace(ringBuf_t *rb){
+	return rb->mask + 1 - (rb->head - rb->tail);
+}
+
+// producer side; returns 0 when the ring is full
+static __inline uint8_t ringPut(ringBuf_t *rb, uint8_t c){
+	uint32_t head = rb->head;
+
+	if (head - rb->tail > rb->mask)
+		return 0;
+	rb->buf[head & rb->mask] = c;
+	__DMB();	// data before index
+	rb->head = head + 1;
+	return 1;
+}
+
+// consumer side; returns 0 when the ring is empty
+static __inline uint8_t ringGet(ringBuf_t *rb, uint8_t *c){
+	uint32_t tail = rb->tail;
+
+	if (rb->head == tail)
+		return 0;
+	*c = rb->buf[tail & rb->mask];
+	__DMB();	// data out before the slot is handed back
+	rb->tail = tail + 1;
+	return 1;
+}
+
+// producer side; copies as much of data as fits, returns bytes written
+static __inline uint32_t ringWrite(ringBuf_t *rb, const uint8_t *data, uint32_t len){
+	uint32_t head = rb->head;
+	uint32_t space = rb->mask + 1 - (head - rb->tail);
+	uint32_t n;
+
+	if (len > space)
+		len = space;
+	for (n = 0; n < len; n++) {
+		rb->buf[(head + n) & rb->mask] = data[n];
+	}
+	__DMB();
+	rb->head = head + len;
+	return len;
+}
+
+// consumer side; copies out up to len bytes, returns bytes read
+static __inline uint32_t ringRead(ringBuf_t *rb, uint8_t *data, uint32_t len){
+	uint32_t tail = rb->tail;
+	uint32_t count = rb->head - tail;
+	uint32_t n;
+
+	if (len > count)
+		len = count;
+	for (n = 0; n < len; n++) {
+		data[n] = rb->buf[(tail + n) & rb->mask];
+	}
+	__DMB();
+	rb->tail = tail + len;
+	return len;
+}
+
+#endif
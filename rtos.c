@@ -0,0 +1,754 @@
+/*
+ * RTOS kernel: task creation and fixed-priority preemptive scheduling.
+ * @author Subhan and Susan, 2018
+ */
+
+#include <LPC17xx.h>
+#include "rtos.h"
+#include "trace.h"
+
+#define SPBIT 0x02
+
+volatile uint32_t msTicks = 0;
+TCB_t tcbList[RTOS_MAX_TASKS];
+
+#ifdef RTOS_STACK_GUARD
+#define STACK_ALIGN	32	// MPU regions are aligned to their size
+#else
+#define STACK_ALIGN	8
+#endif
+
+// task stacks are carved out of this pool, lowest address first
+__align(STACK_ALIGN) static uint64_t stackPool[RTOS_STACK_POOL_SIZE / 8];
+static uint32_t stackPoolUsed = 0;
+
+// the task on the CPU and the one PendSV_Handler will switch to
+TCB_t *currentTask = 0;
+TCB_t *nextTask = 0;
+
+// scheduling points that found the running task should keep the CPU
+volatile uint32_t switchesAvoided = 0;
+
+#ifdef RTOS_BENCH
+static rtosSwitchStats_t switchStats = { 0, 0, 0xFFFFFFFF, 0, 0 };
+uint32_t switchStart;
+#endif
+
+#ifdef RTOS_CPU_STATS
+static uint32_t cpuStamp;	// DWT->CYCCNT when currentTask was last charged
+#endif
+
+#ifdef RTOS_TICKLESS
+static uint32_t tickCycles;	// SysTick cycles in one tick
+static uint32_t tickMaxSpan;	// most ticks the 24-bit counter can cover
+static uint32_t tickSpan = 1;	// ticks the running SysTick period stands for,
+				// 0 once tickResync() has credited them
+static uint32_t tickOffset;	// cycles of the tick gone when the running period began
+
+// shortest SysTick period tickResync() programs
+#define TICK_MIN_CYCLES	64
+#endif
+
+// one circular list per priority level; bit n of readyBitmap is set
+// while readyList[n] is non-empty, so the highest ready level is a CLZ
+static TCB_t *readyList[RTOS_PRIORITIES];
+static uint32_t readyBitmap = 0;
+
+// waiting tasks with a wake-up time, soonest first, so each tick only
+// has to look at the head
+static TCB_t *delayList = 0;
+
+#ifdef RTOS_TICKLESS
+// cycles of the running SysTick period gone by. the counter loads LOAD
+// on the cycle after it is written or reaches zero; callers have ruled
+// out an expiry, so a 0 means it has not started yet
+static uint32_t tickElapsed(void){
+	uint32_t val = SysTick->VAL;
+
+	return (val != 0 ? SysTick->LOAD - val + 1 : 0);
+}
+
+// program the next SysTick interrupt `ticks` ticks ahead; called right
+// after a tick boundary with the counter at its normal reload value
+static void tickStretch(uint32_t ticks){
+	if (ticks > tickMaxSpan)
+		ticks = tickMaxSpan;
+	if (ticks < 2)
+		return;
+
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	tickOffset += tickElapsed();
+	SysTick->LOAD = ticks * tickCycles - tickOffset - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	tickSpan = ticks;
+}
+
+// end a stretched period early: credit msTicks with the ticks that have
+// already passed and let the rest of the current tick run at normal length
+static void tickResync(void){
+	uint32_t elapsed;
+
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		// the period ran out but SysTick_Handler has not run yet: credit
+		// all of it now, so the caller sees the current time, and leave
+		// the handler only the wake-ups to do
+		msTicks += tickSpan;
+		tickSpan = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		return;
+	}
+
+	elapsed = tickOffset + tickElapsed();
+	msTicks += elapsed / tickCycles;
+	tickOffset = elapsed % tickCycles;
+	// too little of the tick left to program, down to a LOAD of 0, which
+	// would stop the counter: run on to the end of the next tick instead.
+	// resyncs only follow a stretch, so the counter can hold two ticks
+	tickSpan = (tickCycles - tickOffset < TICK_MIN_CYCLES ? 2 : 1);
+	SysTick->LOAD = tickSpan * tickCycles - tickOffset - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+}
+#endif
+
+#ifdef RTOS_TICKLESS
+// bring msTicks up to date before anything reads it
+#define tickSync()	do { if (tickSpan != 1) tickResync(); } while (0)
+#else
+#define tickSync()
+#endif
+
+// msTicks as osTickCount() would return it, but without ending a
+// stretch, for code that only wants a timestamp
+uint32_t tickNow(void){
+#ifdef RTOS_TICKLESS
+	uint32_t elapsed;
+
+	if (tickSpan == 1)
+		return msTicks;
+	// the counter keeps running: read it before the pending bit, so an
+	// expiry in between is seen as one
+	elapsed = tickOffset + tickElapsed();
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+		return msTicks + tickSpan;
+	return msTicks + elapsed / tickCycles;
+#else
+	return msTicks;
+#endif
+}
+
+static void readyInsert(TCB_t *tcb){
+	TCB_t *head = readyList[tcb->priority];
+
+#ifdef RTOS_TICKLESS
+	// someone new may need the CPU, so time-slicing has to resume
+	if (tickSpan != 1)
+		tickResync();
+#endif
+
+	if (head == 0) {
+		tcb->next = tcb;
+		tcb->prev = tcb;
+		readyList[tcb->priority] = tcb;
+		readyBitmap |= (1u << tcb->priority);
+	} else {
+		// append at the tail so it runs after its peers
+		tcb->next = head;
+		tcb->prev = head->prev;
+		head->prev->next = tcb;
+		head->prev = tcb;
+	}
+}
+
+static void readyRemove(TCB_t *tcb){
+	if (tcb->next == tcb) {
+		readyList[tcb->priority] = 0;
+		readyBitmap &= ~(1u << tcb->priority);
+	} else {
+		tcb->prev->next = tcb->next;
+		tcb->next->prev = tcb->prev;
+		if (readyList[tcb->priority] == tcb)
+			readyList[tcb->priority] = tcb->next;
+	}
+}
+
+static void delayInsert(TCB_t *tcb, uint32_t wakeTick){
+	TCB_t *prev = 0;
+	TCB_t *cur = delayList;
+
+	// wrap-safe: deadlines are compared as offsets from each other
+	while (cur != 0 && (int32_t)(cur->wakeTick - wakeTick) <= 0) {
+		prev = cur;
+		cur = cur->delayNext;
+	}
+
+	tcb->wakeTick = wakeTick;
+	tcb->flags |= TASK_TIMED;
+	tcb->delayPrev = prev;
+	tcb->delayNext = cur;
+	if (cur != 0)
+		cur->delayPrev = tcb;
+	if (prev != 0)
+		prev->delayNext = tcb;
+	else
+		delayList = tcb;
+}
+
+static void delayRemove(TCB_t *tcb){
+	if (tcb->delayNext != 0)
+		tcb->delayNext->delayPrev = tcb->delayPrev;
+	if (tcb->delayPrev != 0)
+		tcb->delayPrev->delayNext = tcb->delayNext;
+	else
+		delayList = tcb->delayNext;
+	tcb->flags &= ~TASK_TIMED;
+	tcb->delayNext = 0;
+	tcb->delayPrev = 0;
+}
+
+// wait lists are circular like the ready lists but ordered by priority,
+// first come first served among equals
+static void waitInsert(waitList_t *list, TCB_t *tcb){
+	TCB_t *head = list->head;
+	TCB_t *cur = head;
+
+	tcb->waitList = list;
+	if (head == 0) {
+		tcb->next = tcb;
+		tcb->prev = tcb;
+		list->head = tcb;
+		return;
+	}
+
+	// go in front of the first task that ranks below it
+	do {
+		if (cur->priority < tcb->priority)
+			break;
+		cur = cur->next;
+	} while (cur != head);
+
+	tcb->next = cur;
+	tcb->prev = cur->prev;
+	cur->prev->next = tcb;
+	cur->prev = tcb;
+	if (cur == head && head->priority < tcb->priority)
+		list->head = tcb;
+}
+
+static void waitRemove(TCB_t *tcb){
+	waitList_t *list = tcb->waitList;
+
+	if (tcb->next == tcb) {
+		list->head = 0;
+	} else {
+		tcb->prev->next = tcb->next;
+		tcb->next->prev = tcb->prev;
+		if (list->head == tcb)
+			list->head = tcb->next;
+	}
+	tcb->waitList = 0;
+}
+
+static uint8_t highestReady(void){
+	return 31 - __CLZ(readyBitmap);
+}
+
+// block the running task on list (0 for none) for at most timeout ticks;
+// interrupts must be disabled, the switch happens once they are enabled.
+// the caller records TRACE_BLOCK with its object, so the block carries
+// the same ID as the object's other events
+void waitOn(waitList_t *list, uint32_t timeout){
+	readyRemove(currentTask);
+	currentTask->state = waiting;
+	currentTask->waitResult = 0;
+	if (list != 0)
+		waitInsert(list, currentTask);
+	if (timeout != OS_WAIT_FOREVER) {
+		tickSync();
+		delayInsert(currentTask, msTicks + timeout);
+	}
+	schedule();
+}
+
+// make a waiting task ready, taking it off its wait list and the delay
+// list and clearing the mutex it waited on, so no priority is lent
+// through it any more; result is what the blocking call returns. the
+// caller follows up with schedule()
+void wakeTask(TCB_t *tcb, uint8_t result){
+	if (tcb->flags & TASK_TIMED)
+		delayRemove(tcb);
+	if (tcb->waitList != 0)
+		waitRemove(tcb);
+	tcb->waitMutex = 0;
+	tcb->waitResult = result;
+	tcb->state = ready;
+	readyInsert(tcb);
+	trace(TRACE_WAKE, tcb->taskID, result);
+}
+
+// move tcb to another priority level, keeping it on whichever list it
+// is on; the caller follows up with schedule()
+void taskSetPriority(TCB_t *tcb, uint8_t priority){
+	waitList_t *list = tcb->waitList;
+
+	if (tcb->priority == priority)
+		return;
+
+	if (tcb->state == ready || tcb->state == running) {
+		readyRemove(tcb);
+		tcb->priority = priority;
+		readyInsert(tcb);
+	} else if (list != 0) {
+		waitRemove(tcb);
+		tcb->priority = priority;
+		waitInsert(list, tcb);
+	} else {
+		tcb->priority = priority;
+	}
+}
+
+// pick the head of the highest non-empty level and request a switch
+// to it, unless that is the task already running
+void schedule(void){
+	nextTask = readyList[highestReady()];
+	if (nextTask != currentTask)
+		SCB->ICSR |= (0x01 << 28);
+	else
+		switchesAvoided++;
+}
+
+void SysTick_Handler(void) {
+	uint32_t ticks = 1;
+
+	traceIsrEnter();
+	__disable_irq();
+#ifdef RTOS_TICKLESS
+	// nothing left to credit if tickResync() got to the expiry first
+	ticks = tickSpan;
+	tickSpan = 1;
+	// back to one tick per period after a stretch or a resync; the
+	// cycles since the expiry belong to the new tick
+	if (SysTick->LOAD != tickCycles - 1) {
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		tickOffset = tickElapsed();
+		SysTick->LOAD = tickCycles - 1;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	}
+#endif
+	msTicks += ticks;
+
+	// wake every sleeper whose time has come; one that was also waiting
+	// on an object sees its call time out
+	while (delayList != 0 && (int32_t)(delayList->wakeTick - msTicks) <= 0) {
+		wakeTask(delayList, 0);
+	}
+
+	// round robin: once its quantum is used up the running task goes
+	// behind its equal-priority peers
+	if (currentTask->state != running) {
+		// blocked already, the switch away from it is pending
+	} else if (currentTask->sliceLeft > ticks) {
+		currentTask->sliceLeft -= ticks;
+	} else {
+		currentTask->sliceLeft = currentTask->timeSlice;
+		if (readyList[currentTask->priority] == currentTask)
+			readyList[currentTask->priority] = currentTask->next;
+	}
+
+	schedule();
+
+#ifdef RTOS_TICKLESS
+	// alone at the top level there is nothing to time-slice against,
+	// so let the counter run until the next sleeper is due
+	if (nextTask->next == nextTask) {
+		if (delayList != 0)
+			tickStretch(delayList->wakeTick - msTicks);
+		else
+			tickStretch(tickMaxSpan);
+	}
+#endif
+	__enable_irq();
+	traceIsrExit();
+}
+
+static void idleTask(void *args){
+	// sleep until the next interrupt; with RTOS_TICKLESS that can be
+	// many ticks away
+	while(1) {
+		__WFI();
+	}
+}
+
+// a task whose function returns ends up here, on its own stack; it
+// runs again for each queued activation and then parks without a saved
+// context, so the next activation starts it from a fresh frame
+static void taskExit(void){
+	TCB_t *self = currentTask;
+
+	while(1) {
+		__disable_irq();
+		if (self->activations == 0) {
+			self->flags |= TASK_NOFRAME;
+			readyRemove(self);
+			self->state = waiting;
+			trace(TRACE_BLOCK, self->taskID, 0);
+			schedule();
+		} else {
+			self->activations--;
+		}
+		// once parked, the switch away happens here and never comes back
+		__enable_irq();
+
+		self->taskFunc(self->taskArgs);
+	}
+}
+
+// lay down the hardware exception frame a task starts from; no R4-R11
+// are stacked, nothing can be live in them before the first instruction.
+// called by PendSV_Handler when it switches to a TASK_NOFRAME task
+uint32_t startFrame(TCB_t *tcb){
+	uint32_t *sp = (uint32_t *)tcb->taskBase;
+
+	tcb->flags &= ~TASK_NOFRAME;
+
+	// PSR
+	*(--sp) = (uint32_t)0x01000000;
+	// PC, without the thumb bit
+	*(--sp) = (uint32_t)tcb->taskFunc & ~1u;
+	// LR
+	*(--sp) = (uint32_t)taskExit;
+	// R12 to R1
+	for (uint8_t x = 0; x < 4; x++) {
+		*(--sp) = (uint32_t)0x00;
+	}
+	// R0
+	*(--sp) = (uint32_t)tcb->taskArgs;
+
+	tcb->taskSP = (uint32_t)sp;
+	return tcb->taskSP;
+}
+
+#ifdef RTOS_BENCH
+// called by PendSV_Handler once the incoming context is loaded
+void switchTimed(void){
+	uint32_t cycles = DWT->CYCCNT - switchStart;
+
+	switchStats.count++;
+	switchStats.last = cycles;
+	switchStats.total += cycles;
+	if (cycles < switchStats.min)
+		switchStats.min = cycles;
+	if (cycles > switchStats.max)
+		switchStats.max = cycles;
+}
+#endif
+
+#ifdef RTOS_CPU_STATS
+// charge the running task for the cycles since it was last charged;
+// interrupts must be disabled
+static void cpuCharge(void){
+	uint32_t now = DWT->CYCCNT;
+
+	currentTask->cpuCycles += now - cpuStamp;
+	cpuStamp = now;
+}
+
+// called by PendSV_Handler before it switches to nextTask
+void switchAccount(void){
+	cpuCharge();
+	if (nextTask != currentTask)
+		nextTask->cpuSwitches++;
+}
+#endif
+
+// take size bytes (rounded up to STACK_ALIGN) from the stack pool for
+// tcb and paint it so getStackHighWater() can see how deep it got
+static uint8_t stackAlloc(TCB_t *tcb, uint32_t size){
+	size = (size + STACK_ALIGN - 1) & ~(STACK_ALIGN - 1);
+	if (size > RTOS_STACK_POOL_SIZE - stackPoolUsed)
+		return 0;
+
+	for (uint32_t i = 0; i < size; i += 4){
+		*((uint32_t *)((uint32_t)stackPool + stackPoolUsed + i)) = RTOS_STACK_PAINT;
+	}
+
+	stackPoolUsed += size;
+	tcb->stackSize = size;
+	tcb->taskBase = (uint32_t)stackPool + stackPoolUsed;
+	tcb->taskSP = tcb->taskBase;
+	return 1;
+}
+
+// deepest the task's stack has been, in bytes; 0 for no such task
+uint32_t getStackHighWater(uint8_t taskID){
+	TCB_t *tcb;
+	uint32_t addr;
+
+	if (taskID >= RTOS_MAX_TASKS)
+		return 0;
+	tcb = &tcbList[taskID];
+	if (tcb->state == inactive)
+		return 0;
+	addr = tcb->taskBase - tcb->stackSize + RTOS_STACK_GUARD_SIZE;
+	while (addr < tcb->taskBase && *((uint32_t *)addr) == RTOS_STACK_PAINT) {
+		addr += 4;
+	}
+	return tcb->taskBase - addr;
+}
+
+#ifdef RTOS_STACK_GUARD
+// task whose stack ran into its guard region
+volatile uint8_t stackOverflowTask = 0xFF;
+
+void MemManage_Handler(void){
+	stackOverflowTask = currentTask->taskID;
+	while(1);
+}
+#endif
+
+void init(void){	
+	// initialize TCBs
+	// the vector table the core booted from; VTOR is 0 out of reset
+	uint32_t * vectorTable = (uint32_t *)SCB->VTOR;
+	uint32_t mainStackBase = vectorTable[0];
+	
+	for (uint8_t i = 0; i < RTOS_MAX_TASKS; i++){
+		tcbList[i].taskID = i;
+		tcbList[i].state = inactive;
+	}
+	
+	// 2) copy the live part of the main stack to main's process stack
+	uint32_t mainSP = __get_MSP();
+	stackAlloc(&tcbList[0], RTOS_MAIN_STACK_SIZE);
+	tcbList[0].taskSP = tcbList[0].taskBase - (mainStackBase - mainSP);
+	for (uint32_t i = 0; i < mainStackBase - mainSP; i += 4){
+		*((uint32_t *)(tcbList[0].taskSP + i)) = *((uint32_t *)(mainSP + i));
+	}
+	tcbList[0].priority = RTOS_MAIN_PRIORITY;
+	tcbList[0].basePriority = RTOS_MAIN_PRIORITY;
+	tcbList[0].waitMutex = 0;
+	tcbList[0].heldMutexes = 0;
+	tcbList[0].timeSlice = RTOS_TIME_SLICE;
+	tcbList[0].sliceLeft = RTOS_TIME_SLICE;
+	tcbList[0].flags = 0;
+	tcbList[0].waitList = 0;
+	tcbList[0].state = running;
+	readyInsert(&tcbList[0]);
+	currentTask = &tcbList[0];
+	nextTask = &tcbList[0];
+
+#if defined(RTOS_BENCH) || defined(RTOS_CPU_STATS) || defined(RTOS_TRACE)
+	// free-running cycle counter for switch timing, CPU accounting and
+	// trace timestamps
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+#ifdef RTOS_CPU_STATS
+	tcbList[0].cpuCycles = 0;
+	tcbList[0].cpuWindow = 0;
+	tcbList[0].cpuSwitches = 1;
+	cpuStamp = DWT->CYCCNT;
+#endif
+	trace(TRACE_CREATE, 0, RTOS_MAIN_PRIORITY);
+
+	// PendSV must not preempt other handlers mid-way through the ready lists
+	NVIC_SetPriority(PendSV_IRQn, 0xFF);
+
+#ifdef RTOS_STACK_GUARD
+	// region 7: 32 bytes, no access, no execute. PendSV_Handler moves it
+	// to the bottom of each task's stack as the task is switched in
+	MPU->RNR = 7;
+	MPU->RBAR = tcbList[0].taskBase - tcbList[0].stackSize;
+	MPU->RASR = (1u << 28) | (4u << 1) | 1u;
+	MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+	SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+	__DSB();
+	__ISB();
+#endif
+
+	__set_MSP(mainStackBase);
+	__set_CONTROL(__get_CONTROL() | SPBIT);
+	__set_PSP(tcbList[0].taskSP);
+
+	createTask(idleTask, 0, RTOS_IDLE_PRIORITY, RTOS_TIME_SLICE, RTOS_IDLE_STACK_SIZE, 0);
+
+	// start the tick
+	SysTick_Config(SystemCoreClock/RTOS_TICK_HZ);
+#ifdef RTOS_TICKLESS
+	tickCycles = SystemCoreClock/RTOS_TICK_HZ;
+	tickMaxSpan = (SysTick_LOAD_RELOAD_Msk + 1) / tickCycles;
+#endif
+}
+
+uint8_t createTask(rtosTaskFunc_t funcPtr, void * args, uint8_t priority, uint32_t timeSlice, uint32_t stackSize, uint8_t flags) {
+	int i = 1;
+
+	if (priority >= RTOS_PRIORITIES)
+		return 0;
+	if (stackSize == 0)
+		stackSize = RTOS_STACK_SIZE;
+	if (stackSize < RTOS_MIN_STACK_SIZE)
+		return 0;
+
+	__disable_irq();
+	// find next unused TCB
+	while(tcbList[i].state != inactive) {
+		i++;
+		if (i >= RTOS_MAX_TASKS) {
+			__enable_irq();
+			return 0;
+		}
+	}
+	if (!stackAlloc(&tcbList[i], stackSize)) {
+		__enable_irq();
+		return 0;
+	}
+	// claimed; not on any list until it is made ready below
+	tcbList[i].state = waiting;
+	__enable_irq();
+	
+	// the frame is built by PendSV_Handler when the task is first switched in
+	tcbList[i].taskFunc = funcPtr;
+	tcbList[i].taskArgs = args;
+	tcbList[i].flags = TASK_NOFRAME;
+	tcbList[i].activations = 0;
+	tcbList[i].waitList = 0;
+	tcbList[i].priority = priority;
+	tcbList[i].basePriority = priority;
+	tcbList[i].waitMutex = 0;
+	tcbList[i].heldMutexes = 0;
+	tcbList[i].timeSlice = (timeSlice != 0 ? timeSlice : RTOS_TIME_SLICE);
+	tcbList[i].sliceLeft = tcbList[i].timeSlice;
+#ifdef RTOS_CPU_STATS
+	tcbList[i].cpuCycles = 0;
+	tcbList[i].cpuWindow = 0;
+	tcbList[i].cpuSwitches = 0;
+#endif
+
+	trace(TRACE_CREATE, i, priority);
+
+	// run-to-completion tasks stay parked until activateTask()
+	if (flags & RTOS_TASK_RUN_TO_COMPLETION)
+		return i;
+
+	// set it to ready to run
+	__disable_irq();
+	tcbList[i].state = ready;
+	readyInsert(&tcbList[i]);
+	// preempt the caller right away if the new task outranks it; a
+	// switch already pending may have picked some other task
+	schedule();
+	__enable_irq();
+	
+	return i;
+}
+
+// run a parked task from the top of its function, or queue another run
+// if it is still busy; safe to call from interrupt handlers
+void activateTask(uint8_t taskID){
+	TCB_t *tcb = &tcbList[taskID];
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (tcb->state == waiting && (tcb->flags & TASK_NOFRAME)) {
+		tcb->state = ready;
+		readyInsert(tcb);
+		trace(TRACE_WAKE, taskID, 1);
+		// from an interrupt a switch may be pending already, so rank
+		// against the whole ready set rather than currentTask
+		schedule();
+	} else if (tcb->state != inactive) {
+		tcb->activations++;
+	}
+	__set_PRIMASK(primask);
+}
+
+#ifdef RTOS_BENCH
+void getSwitchStats(rtosSwitchStats_t *stats){
+	__disable_irq();
+	*stats = switchStats;
+	__enable_irq();
+}
+#endif
+
+#ifdef RTOS_CPU_STATS
+// fill stats with one entry per task, at most max; returns how many.
+// load covers the time since the previous call
+uint8_t getTaskStats(rtosTaskStats_t *stats, uint8_t max){
+	uint64_t window = 0;
+	uint8_t n = 0;
+	uint8_t i;
+
+	__disable_irq();
+	// bring the running task's share up to now
+	cpuCharge();
+	// every cycle is charged to some task, so their sum is the window
+	for (i = 0; i < RTOS_MAX_TASKS; i++) {
+		if (tcbList[i].state != inactive)
+			window += tcbList[i].cpuCycles - tcbList[i].cpuWindow;
+	}
+	for (i = 0; i < RTOS_MAX_TASKS; i++) {
+		TCB_t *tcb = &tcbList[i];
+
+		if (tcb->state == inactive)
+			continue;
+		if (n < max) {
+			stats[n].taskID = tcb->taskID;
+			stats[n].priority = tcb->priority;
+			stats[n].state = tcb->state;
+			stats[n].switches = tcb->cpuSwitches;
+			stats[n].cycles = tcb->cpuCycles;
+			stats[n].load = (window != 0 ? (uint16_t)((tcb->cpuCycles - tcb->cpuWindow) * 1000 / window) : 0);
+			n++;
+		}
+		// the next window starts now for every task
+		tcb->cpuWindow = tcb->cpuCycles;
+	}
+	__enable_irq();
+
+	return n;
+}
+#endif
+
+// move the running task to the delay list; interrupts must be disabled
+static void delayUntil(uint32_t tick){
+	if ((int32_t)(tick - msTicks) > 0) {
+		readyRemove(currentTask);
+		currentTask->state = waiting;
+		trace(TRACE_BLOCK, currentTask->taskID, 0);
+		delayInsert(currentTask, tick);
+		schedule();
+	}
+}
+
+// block the calling task until msTicks reaches tick
+void osDelayUntil(uint32_t tick){
+	__disable_irq();
+	// msTicks lags while the tick is stretched
+	tickSync();
+	delayUntil(tick);
+	__enable_irq();
+}
+
+// msTicks brought up to date; use it instead of reading msTicks in tasks
+uint32_t osTickCount(void){
+	uint32_t primask = enterCritical();
+	uint32_t ticks;
+
+	tickSync();
+	ticks = msTicks;
+	exitCritical(primask);
+	return ticks;
+}
+
+// block the calling task for ms ticks
+void osDelay(uint32_t ms){
+	__disable_irq();
+	tickSync();
+	delayUntil(msTicks + ms);
+	__enable_irq();
+}
@@ -0,0 +1,162 @@
+/*
+ * RTOS kernel header file
+ * @author Subhan and Susan, 2018
+ */
+#ifndef __rtos_h
+#define __rtos_h
+
+#include <LPC17xx.h>
+#include <stdint.h>
+#include "rtos_config.h"
+
+#define RTOS_PRIORITIES		32	// one bit per level in the ready bitmap
+#define RTOS_IDLE_PRIORITY	0	// idle task, runs when nothing else is ready
+#define RTOS_STACK_PAINT	0xDEADBEEF	// fill for unused stack
+
+#ifdef RTOS_STACK_GUARD
+#define RTOS_STACK_GUARD_SIZE	32	// bottom of each stack, no access
+#else
+#define RTOS_STACK_GUARD_SIZE	0
+#endif
+
+// createTask flags
+#define RTOS_TASK_RUN_TO_COMPLETION	0x01	// start parked, run once per activateTask()
+
+// TCB flags
+#define TASK_NOFRAME	0x01	// no R4-R11 on the stack: parked or never run
+#define TASK_TIMED	0x02	// on the delay list
+
+// timeouts for blocking calls, otherwise in ticks
+#define OS_NO_WAIT		0
+#define OS_WAIT_FOREVER	0xFFFFFFFF
+
+typedef void (*rtosTaskFunc_t)(void *args);
+
+enum states{
+	inactive,
+	waiting,
+	ready,
+	running
+};
+
+struct osMutex;
+
+// tasks blocked on a kernel object, highest priority first
+typedef struct waitList {
+	struct TCB *head;
+} waitList_t;
+
+typedef struct TCB {
+	uint8_t taskID;
+	uint8_t priority;	// higher value runs first; raised while inheriting
+	uint8_t basePriority;	// priority given to createTask
+	uint8_t flags;
+	uint32_t timeSlice;	// ticks to run before yielding to an equal-priority peer
+	uint32_t sliceLeft;
+	uint32_t taskBase;	// top of the stack
+	uint32_t taskSP;
+	uint32_t stackSize;	// bytes below taskBase
+	rtosTaskFunc_t taskFunc;
+	void *taskArgs;
+	uint32_t activations;	// runs queued while the task was busy
+	
+	uint8_t state;		// enum states; a byte so PendSV_Handler can use LDRB
+	
+	// links in the ready list of this task's priority level, or in
+	// waitList while blocked on a kernel object
+	struct TCB *next;
+	struct TCB *prev;
+	waitList_t *waitList;
+	uint8_t waitResult;	// returned by the blocking call once woken
+	void *waitData;		// per-object wait details: queue message, event mask
+
+	// priority inheritance bookkeeping
+	struct osMutex *waitMutex;	// mutex this task is blocked on
+	struct osMutex *heldMutexes;	// mutexes this task owns
+
+	// links in the kernel's delay list while waiting for wakeTick
+	uint32_t wakeTick;
+	struct TCB *delayNext;
+	struct TCB *delayPrev;
+
+#ifdef RTOS_CPU_STATS
+	uint64_t cpuCycles;	// run time, interrupts included
+	uint64_t cpuWindow;	// cpuCycles at the last getTaskStats()
+	uint32_t cpuSwitches;	// times switched in
+#endif
+} TCB_t;
+
+#ifdef RTOS_BENCH
+// PendSV_Handler cost in CPU cycles, measured with the DWT cycle counter
+typedef struct {
+	uint32_t count;
+	uint32_t last;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+} rtosSwitchStats_t;
+#endif
+
+#ifdef RTOS_CPU_STATS
+// one task's share of the CPU, from the DWT cycle counter
+typedef struct {
+	uint8_t taskID;
+	uint8_t priority;
+	uint8_t state;
+	uint16_t load;		// tenths of a percent since the last getTaskStats()
+	uint32_t switches;
+	uint64_t cycles;
+} rtosTaskStats_t;
+#endif
+
+extern volatile uint32_t msTicks;
+extern TCB_t tcbList[RTOS_MAX_TASKS];
+extern TCB_t *currentTask;
+extern TCB_t *nextTask;
+extern volatile uint32_t switchesAvoided;
+
+void init(void);
+uint8_t createTask(rtosTaskFunc_t funcPtr, void * args, uint8_t priority, uint32_t timeSlice, uint32_t stackSize, uint8_t flags);
+void activateTask(uint8_t taskID);
+uint32_t getStackHighWater(uint8_t taskID);
+void osDelay(uint32_t ms);
+void osDelayUntil(uint32_t tick);
+uint32_t osTickCount(void);
+
+#ifdef RTOS_BENCH
+void getSwitchStats(rtosSwitchStats_t *stats);
+#endif
+#ifdef RTOS_CPU_STATS
+uint8_t getTaskStats(rtosTaskStats_t *stats, uint8_t max);
+#endif
+
+// nestable critical section, usable from tasks and interrupt handlers
+static __inline uint32_t enterCritical(void){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+static __inline void exitCritical(uint32_t primask){
+	__set_PRIMASK(primask);
+}
+
+// kernel internals for the synchronization objects; call with
+// interrupts disabled
+void waitOn(waitList_t *list, uint32_t timeout);
+void wakeTask(TCB_t *tcb, uint8_t result);
+void taskSetPriority(TCB_t *tcb, uint8_t priority);
+void schedule(void);
+uint32_t tickNow(void);
+
+// kernel internals used by PendSV_Handler in context.c
+uint32_t startFrame(TCB_t *tcb);
+#ifdef RTOS_BENCH
+extern uint32_t switchStart;
+void switchTimed(void);
+#endif
+#ifdef RTOS_CPU_STATS
+void switchAccount(void);
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * RTOS compile-time configuration. Every value can be overridden from
+ * the project's preprocessor defines.
+ */
+#ifndef __rtos_config_h
+#define __rtos_config_h
+
+// tasks, including main() and the idle task
+#ifndef RTOS_MAX_TASKS
+#define RTOS_MAX_TASKS		6
+#endif
+
+// bytes of RAM shared by all task stacks
+#ifndef RTOS_STACK_POOL_SIZE
+#define RTOS_STACK_POOL_SIZE	6144
+#endif
+
+// stack size used when createTask is given 0
+#ifndef RTOS_STACK_SIZE
+#define RTOS_STACK_SIZE		1024
+#endif
+
+// smallest stack createTask accepts: initial frame plus one exception frame
+#ifndef RTOS_MIN_STACK_SIZE
+#define RTOS_MIN_STACK_SIZE	128
+#endif
+
+// stack main() continues on after init()
+#ifndef RTOS_MAIN_STACK_SIZE
+#define RTOS_MAIN_STACK_SIZE	1024
+#endif
+
+#ifndef RTOS_IDLE_STACK_SIZE
+#define RTOS_IDLE_STACK_SIZE	256
+#endif
+
+// priority main() runs at after init()
+#ifndef RTOS_MAIN_PRIORITY
+#define RTOS_MAIN_PRIORITY	1
+#endif
+
+// msTicks rate
+#ifndef RTOS_TICK_HZ
+#define RTOS_TICK_HZ		1000
+#endif
+
+// default round-robin quantum in ticks
+#ifndef RTOS_TIME_SLICE
+#define RTOS_TIME_SLICE		1
+#endif
+
+// deferred-work task started by osWorkStart(); runs above everything
+// else so work posted by interrupt handlers is not held up by tasks
+#ifndef RTOS_WORK_PRIORITY
+#define RTOS_WORK_PRIORITY	31
+#endif
+
+#ifndef RTOS_WORK_STACK_SIZE
+#define RTOS_WORK_STACK_SIZE	512
+#endif
+
+// task osTimerServiceStart() creates to run software timer callbacks
+#ifndef RTOS_TIMER_PRIORITY
+#define RTOS_TIMER_PRIORITY	30
+#endif
+
+#ifndef RTOS_TIMER_STACK_SIZE
+#define RTOS_TIMER_STACK_SIZE	512
+#endif
+
+// define RTOS_TICKLESS to stop the periodic tick while the highest ready
+// level holds a single task; msTicks is corrected when ticking resumes
+
+// define RTOS_STACK_GUARD to keep an MPU no-access region under the
+// running task's stack, so an overflow faults instead of corrupting memory
+
+// define RTOS_BENCH to time every context switch with the DWT cycle counter
+
+// define RTOS_CPU_STATS to charge every task with the cycles it runs for,
+// read back with getTaskStats()
+
+// define RTOS_TRACE to record scheduler, interrupt and synchronization
+// events for tools/trace2json.py; see trace.h
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Counting semaphores. A signal with tasks waiting hands the unit
+ * straight to the highest-priority waiter instead of bumping the count,
+ * so no other task can take it in between.
+ */
+
+#include "semaphore.h"
+#include "trace.h"
+
+void osSemInit(osSem_t *sem, uint32_t count){
+	sem->count = count;
+	sem->waiters.head = 0;
+}
+
+// take one unit, blocking for at most timeout ticks; returns 1 when the
+// unit was taken and 0 on timeout. OS_NO_WAIT makes it a try
+uint8_t osSemWait(osSem_t *sem, uint32_t timeout){
+	uint32_t primask = enterCritical();
+
+	if (sem->count > 0) {
+		sem->count--;
+		exitCritical(primask);
+		return 1;
+	}
+	if (timeout == OS_NO_WAIT) {
+		exitCritical(primask);
+		return 0;
+	}
+
+	trace(TRACE_BLOCK, currentTask->taskID, sem);
+	waitOn(&sem->waiters, timeout);
+	exitCritical(primask);
+
+	// back here once signalled or timed out
+	return currentTask->waitResult;
+}
+
+// give one unit; safe to call from interrupt handlers. the switch to the
+// woken task is only requested if it outranks the one running
+void osSemSignal(osSem_t *sem){
+	uint32_t primask = enterCritical();
+
+	trace(TRACE_SEM_SIGNAL, traceTaskID(), sem);
+
+	if (sem->waiters.head != 0) {
+		wakeTask(sem->waiters.head, 1);
+		schedule();
+	} else {
+		sem->count++;
+	}
+	exitCritical(primask);
+}
@@ -0,0 +1,19 @@
+/*
+ * counting semaphore header file
+ */
+#ifndef __semaphore_h
+#define __semaphore_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+typedef struct {
+	volatile uint32_t count;
+	waitList_t waiters;
+} osSem_t;
+
+void osSemInit(osSem_t *sem, uint32_t count);
+uint8_t osSemWait(osSem_t *sem, uint32_t timeout);
+void osSemSignal(osSem_t *sem);
+
+#endif
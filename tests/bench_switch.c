@@ -0,0 +1,116 @@
+/*
+ * Host benchmark of the scheduling side of a time-slice switch, before
+ * and after the kernel tracked currentTask/nextTask.
+ *
+ * before: the original PendSV_Handler, which scanned tcbList for the
+ *         running task and then for the next ready one on every switch.
+ * after:  SysTick_Handler rotating the level and calling schedule(),
+ *         then the pointer swap PendSV_Handler does.
+ *
+ * N tasks share one priority and every tick switches to the next. The
+ * register save/restore is not part of this; it is the same eight words
+ * either way. Host nanoseconds are not Cortex-M3 cycles, but the way the
+ * cost grows with N is the point.
+ */
+
+#include <time.h>
+#include "sim.h"
+
+#define SWITCHES	2000000
+
+// the original TCB and PendSV_Handler selection, as it was in main_default.c
+typedef struct {
+	uint8_t taskID;
+	uint32_t taskBase;
+	uint32_t taskSP;
+	uint8_t state;
+} legacyTCB_t;
+
+static legacyTCB_t legacyList[RTOS_MAX_TASKS];
+static volatile uint32_t legacyTicks;
+
+static void legacySwitch(uint8_t tasks){
+	uint8_t i = 0;
+	uint8_t j;
+
+	// find running task
+	while (legacyList[i].state != running) {
+		i++;
+	}
+
+	// find next ready task
+	j = i;
+	while (legacyList[j].state != ready) {
+		j = (j+1)%tasks;
+	}
+
+	legacyList[i].state = ready;
+	legacyList[j].state = running;
+}
+
+static double now(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double before(uint8_t tasks){
+	double start;
+	uint32_t n;
+	uint8_t i;
+
+	for (i = 0; i < tasks; i++)
+		legacyList[i].state = (i == 0 ? running : ready);
+
+	start = now();
+	for (n = 0; n < SWITCHES; n++) {
+		// the old SysTick_Handler: count and pend PendSV
+		legacyTicks++;
+		legacySwitch(tasks);
+	}
+	return (now() - start) / SWITCHES;
+}
+
+static double after(void){
+	double start;
+	uint32_t n;
+
+	start = now();
+	for (n = 0; n < SWITCHES; n++) {
+		SysTick_Handler();
+		SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+		// PendSV_Handler
+		if (currentTask->state == running)
+			currentTask->state = ready;
+		currentTask = nextTask;
+		currentTask->state = running;
+	}
+	return (now() - start) / SWITCHES;
+}
+
+static void taskFunc(void *args){
+}
+
+int main(void){
+	static const uint8_t counts[] = { 2, 4, 8, 16, 32 };
+	uint8_t created = 0;
+	unsigned i;
+
+	simBoot();
+
+	printf("tasks  before ns/switch  after ns/switch\n");
+	for (i = 0; i < sizeof(counts); i++) {
+		// the new kernel also has main and idle, below the level
+		while (created < counts[i]) {
+			if (createTask(taskFunc, 0, 2, 1, RTOS_MIN_STACK_SIZE, 0) == 0) {
+				printf("createTask failed\n");
+				return 1;
+			}
+			created++;
+		}
+		simRun();
+		printf("%5u  %16.1f  %15.1f\n", counts[i], before(counts[i]), after());
+	}
+	return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * Host simulation of the Cortex-M3 core: see sim.h.
+ */
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sim.h"
+
+static SCB_Type simSCB;
+static SysTick_Type simSysTick;
+static DWT_Type simDWT;
+static CoreDebug_Type simCoreDebug;
+static MPU_Type simMPU;
+
+SCB_Type *SCB = &simSCB;
+SysTick_Type *SysTick = &simSysTick;
+DWT_Type *DWT = &simDWT;
+CoreDebug_Type *CoreDebug = &simCoreDebug;
+MPU_Type *MPU = &simMPU;
+uint32_t SystemCoreClock = 100000000;
+
+uint64_t simClock;
+int simFailures;
+
+static uint32_t primask;
+
+// init() reads the initial MSP from the vector table and moves the live
+// part of the main stack onto main()'s task stack
+static uint32_t simVectors[16];
+static uint32_t simMainStack[64];
+
+void simBoot(void){
+	simClock = 0;
+	primask = 0;
+	simVectors[0] = (uint32_t)&simMainStack[64];
+	SCB->VTOR = (uint32_t)simVectors;
+	init();
+}
+
+void simCycles(uint64_t cycles){
+	uint32_t step;
+
+	if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+		DWT->CYCCNT += (uint32_t)cycles;
+
+	while (cycles > 0) {
+		if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)) {
+			simClock += cycles;
+			return;
+		}
+		// the counter reloads on the cycle after it reaches zero or is
+		// written, and raises the interrupt as it gets to zero again
+		if (SysTick->VAL == 0) {
+			SysTick->VAL = SysTick->LOAD & SysTick_LOAD_RELOAD_Msk;
+			simClock++;
+			cycles--;
+			continue;
+		}
+		step = (cycles < SysTick->VAL ? (uint32_t)cycles : SysTick->VAL);
+		SysTick->VAL -= step;
+		simClock += step;
+		cycles -= step;
+		if (SysTick->VAL == 0) {
+			SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+			if (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk)
+				SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+		}
+	}
+}
+
+uint64_t simCyclesToTick(void){
+	if (SysTick->VAL == 0)
+		return (uint64_t)(SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+	return SysTick->VAL;
+}
+
+// what PendSV_Handler does, minus the registers
+static void simSwitch(void){
+	if (currentTask->state == running)
+		currentTask->state = ready;
+	currentTask = nextTask;
+	currentTask->state = running;
+	if (currentTask->flags & TASK_NOFRAME)
+		startFrame(currentTask);
+}
+
+void simRun(void){
+	while (primask == 0) {
+		if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+			SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+			simCycles(SIM_ENTRY_CYCLES);
+			SysTick_Handler();
+		} else if (SCB->ICSR & SCB_ICSR_PENDSVSET_Msk) {
+			SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+			simSwitch();
+		} else {
+			break;
+		}
+	}
+}
+
+void simTick(void){
+	simCycles(simCyclesToTick());
+	simRun();
+}
+
+int simCase(const char *name, void (*fn)(void)){
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0) {
+		fn();
+		fflush(stdout);
+		_exit(simFailures != 0);
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+		printf("%s: could not run\n", name);
+		return 1;
+	}
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+		printf("%s: ok\n", name);
+		return 0;
+	}
+	if (WIFSIGNALED(status))
+		printf("%s: FAILED, signal %d\n", name, WTERMSIG(status));
+	else
+		printf("%s: FAILED\n", name);
+	return 1;
+}
+
+// SysTick_Config() from core_cm3.h
+uint32_t SysTick_Config(uint32_t ticks){
+	if (ticks - 1 > SysTick_LOAD_RELOAD_Msk)
+		return 1;
+	SysTick->LOAD = ticks - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	return 0;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority){
+}
+
+uint32_t __get_MSP(void){
+	// a few words of main()'s stack are live
+	return (uint32_t)&simMainStack[56];
+}
+
+void __set_MSP(uint32_t topOfMainStack){
+}
+
+uint32_t __get_PSP(void){
+	return currentTask != 0 ? currentTask->taskSP : 0;
+}
+
+void __set_PSP(uint32_t topOfProcStack){
+}
+
+uint32_t __get_CONTROL(void){
+	return 0;
+}
+
+void __set_CONTROL(uint32_t control){
+}
+
+uint32_t __get_PRIMASK(void){
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t priMask){
+	primask = priMask & 1;
+}
+
+uint32_t __get_IPSR(void){
+	return 0;
+}
+
+void __disable_irq(void){
+	primask = 1;
+}
+
+void __enable_irq(void){
+	primask = 0;
+}
+
+void __WFI(void){
+}
+
+void __NOP(void){
+}
+
+void __DSB(void){
+	__sync_synchronize();
+}
+
+void __ISB(void){
+	__sync_synchronize();
+}
+
+void __DMB(void){
+	__sync_synchronize();
+}
+
+void __CLREX(void){
+}
+
+uint8_t __CLZ(uint32_t value){
+	return value != 0 ? __builtin_clz(value) : 32;
+}
+
+// nothing else runs between a test's LDREX and STREX
+uint32_t __LDREXW(volatile uint32_t *addr){
+	return *addr;
+}
+
+uint32_t __STREXW(uint32_t value, volatile uint32_t *addr){
+	*addr = value;
+	return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Host simulation of the Cortex-M3 core the kernel runs on.
+ *
+ * Tasks never really run: a test plays whichever task is currentTask and
+ * calls the kernel the way that task would. Time only moves when the test
+ * runs the simulated clock, which counts SysTick down and sets its
+ * pending bit; pending SysTick and PendSV exceptions are only taken in
+ * simRun(), and PendSV is modelled by the task swap PendSV_Handler does.
+ */
+#ifndef __sim_h
+#define __sim_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "rtos.h"
+
+// cycles from an exception being taken to the first instruction of its
+// handler
+#define SIM_ENTRY_CYCLES	12
+
+// core cycles since simBoot()
+extern uint64_t simClock;
+
+// failed CHECKs in this case
+extern int simFailures;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		simFailures++; \
+	} \
+} while (0)
+
+// rtos.c's SysTick interrupt handler
+void SysTick_Handler(void);
+
+// reset the peripherals and call init(); main() is then tcbList[0]
+void simBoot(void);
+
+// run the core clock
+void simCycles(uint64_t cycles);
+
+// cycles until SysTick next reaches zero
+uint64_t simCyclesToTick(void);
+
+// take pending SysTick and PendSV exceptions while PRIMASK allows it
+void simRun(void);
+
+// run the clock up to the next SysTick interrupt and take it
+void simTick(void);
+
+// run fn in a process of its own, so every case starts from a freshly
+// booted kernel; returns 1 if it failed
+int simCase(const char *name, void (*fn)(void));
+
+#endif
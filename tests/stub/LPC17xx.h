@@ -0,0 +1,113 @@
+/*
+ * Host stand-in for the LPC17xx device header: just the core peripherals
+ * and CMSIS intrinsics the kernel uses. The registers are plain structs
+ * and the intrinsics are functions, both defined by sim.c.
+ */
+#ifndef __LPC17xx_H__
+#define __LPC17xx_H__
+
+#include <stdint.h>
+
+#define __I		volatile const
+#define __O		volatile
+#define __IO		volatile
+
+// armcc keywords
+#define __align(x)	__attribute__((aligned(x)))
+#define __irq
+
+typedef enum {
+	MemoryManagement_IRQn	= -12,
+	PendSV_IRQn		= -2,
+	SysTick_IRQn		= -1
+} IRQn_Type;
+
+typedef struct {
+	__I  uint32_t CPUID;
+	__IO uint32_t ICSR;
+	__IO uint32_t VTOR;
+	__IO uint32_t AIRCR;
+	__IO uint32_t SCR;
+	__IO uint32_t CCR;
+	__IO uint8_t  SHP[12];
+	__IO uint32_t SHCSR;
+} SCB_Type;
+
+typedef struct {
+	__IO uint32_t CTRL;
+	__IO uint32_t LOAD;
+	__IO uint32_t VAL;
+	__I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+	__IO uint32_t CTRL;
+	__IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	__IO uint32_t DHCSR;
+	__O  uint32_t DCRSR;
+	__IO uint32_t DCRDR;
+	__IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+	__I  uint32_t TYPE;
+	__IO uint32_t CTRL;
+	__IO uint32_t RNR;
+	__IO uint32_t RBAR;
+	__IO uint32_t RASR;
+} MPU_Type;
+
+extern SCB_Type *SCB;
+extern SysTick_Type *SysTick;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+extern MPU_Type *MPU;
+extern uint32_t SystemCoreClock;
+
+#define SCB_ICSR_PENDSVSET_Msk		(1UL << 28)
+#define SCB_ICSR_PENDSVCLR_Msk		(1UL << 27)
+#define SCB_ICSR_PENDSTSET_Msk		(1UL << 26)
+#define SCB_ICSR_PENDSTCLR_Msk		(1UL << 25)
+#define SCB_SHCSR_MEMFAULTENA_Msk	(1UL << 16)
+
+#define SysTick_CTRL_COUNTFLAG_Msk	(1UL << 16)
+#define SysTick_CTRL_CLKSOURCE_Msk	(1UL << 2)
+#define SysTick_CTRL_TICKINT_Msk	(1UL << 1)
+#define SysTick_CTRL_ENABLE_Msk		(1UL)
+#define SysTick_LOAD_RELOAD_Msk		(0xFFFFFFUL)
+
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+
+#define MPU_CTRL_PRIVDEFENA_Msk		(1UL << 2)
+#define MPU_CTRL_ENABLE_Msk		(1UL)
+
+uint32_t SysTick_Config(uint32_t ticks);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+uint32_t __get_MSP(void);
+void __set_MSP(uint32_t topOfMainStack);
+uint32_t __get_PSP(void);
+void __set_PSP(uint32_t topOfProcStack);
+uint32_t __get_CONTROL(void);
+void __set_CONTROL(uint32_t control);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+uint32_t __get_IPSR(void);
+void __disable_irq(void);
+void __enable_irq(void);
+
+void __WFI(void);
+void __NOP(void);
+void __DSB(void);
+void __ISB(void);
+void __DMB(void);
+void __CLREX(void);
+uint8_t __CLZ(uint32_t value);
+uint32_t __LDREXW(volatile uint32_t *addr);
+uint32_t __STREXW(uint32_t value, volatile uint32_t *addr);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * Fixed-block pools: exhaustion, statistics, frees in any order and
+ * frees that must be refused.
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "pool.h"
+
+#define BLOCK_SIZE	22	// rounded up to 24
+#define BLOCKS		8
+
+static uint32_t storage[OS_POOL_WORDS(BLOCK_SIZE, BLOCKS)];
+static osPool_t pool;
+
+static uint32_t seed = 99;
+
+static uint32_t rnd(uint32_t limit){
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % limit;
+}
+
+static void checkStats(uint32_t used, uint32_t maxUsed, uint32_t failed){
+	osPoolStats_t stats;
+
+	osPoolGetStats(&pool, &stats);
+	CHECK(stats.blocks == BLOCKS);
+	CHECK(stats.used == used);
+	CHECK(stats.maxUsed == maxUsed);
+	CHECK(stats.failed == failed);
+}
+
+// every block handed out is a distinct, whole block of the pool
+static void checkBlocks(uint8_t **blocks, int n){
+	uint32_t offset;
+	int i, j;
+
+	for (i = 0; i < n; i++) {
+		offset = blocks[i] - (uint8_t *)storage;
+		CHECK(blocks[i] != 0);
+		CHECK(offset % pool.blockSize == 0);
+		CHECK(offset + pool.blockSize <= sizeof(storage));
+		for (j = 0; j < i; j++)
+			CHECK(blocks[i] != blocks[j]);
+	}
+}
+
+static void exhaust(void){
+	uint8_t *blocks[BLOCKS];
+	int i;
+
+	osPoolInit(&pool, storage, BLOCK_SIZE, BLOCKS);
+	CHECK(pool.blockSize == 24);
+	checkStats(0, 0, 0);
+
+	for (i = 0; i < BLOCKS; i++) {
+		blocks[i] = osPoolAlloc(&pool);
+		CHECK(blocks[i] != 0);
+		memset(blocks[i], i, BLOCK_SIZE);
+	}
+	checkBlocks(blocks, BLOCKS);
+	checkStats(BLOCKS, BLOCKS, 0);
+
+	// empty: refused and counted
+	CHECK(osPoolAlloc(&pool) == 0);
+	CHECK(osPoolAlloc(&pool) == 0);
+	checkStats(BLOCKS, BLOCKS, 2);
+
+	// no block overlapped another
+	for (i = 0; i < BLOCKS; i++)
+		CHECK(blocks[i][0] == i && blocks[i][BLOCK_SIZE - 1] == i);
+}
+
+static void scrambledFree(void){
+	static const uint8_t order[BLOCKS] = { 5, 2, 7, 0, 3, 6, 1, 4 };
+	uint8_t *blocks[BLOCKS];
+	uint8_t *again[BLOCKS];
+	int i, j, found;
+
+	osPoolInit(&pool, storage, BLOCK_SIZE, BLOCKS);
+	for (i = 0; i < BLOCKS; i++)
+		blocks[i] = osPoolAlloc(&pool);
+
+	for (i = 0; i < BLOCKS; i++) {
+		CHECK(osPoolFree(&pool, blocks[order[i]]) == 1);
+		checkStats(BLOCKS - 1 - i, BLOCKS, 0);
+	}
+
+	// the same blocks come back, whatever order they were freed in
+	for (i = 0; i < BLOCKS; i++)
+		again[i] = osPoolAlloc(&pool);
+	checkBlocks(again, BLOCKS);
+	for (i = 0; i < BLOCKS; i++) {
+		found = 0;
+		for (j = 0; j < BLOCKS; j++)
+			found += (again[i] == blocks[j]);
+		CHECK(found == 1);
+	}
+	CHECK(osPoolAlloc(&pool) == 0);
+	checkStats(BLOCKS, BLOCKS, 1);
+}
+
+static void fragment(void){
+	uint8_t *held[BLOCKS];
+	uint32_t failed = 0, maxUsed = 0;
+	int n = 0, i, k;
+
+	osPoolInit(&pool, storage, BLOCK_SIZE, BLOCKS);
+
+	// random allocs and frees, holes anywhere; the pool's view has to
+	// match the blocks actually held
+	for (i = 0; i < 100000; i++) {
+		if (rnd(2) == 0) {
+			uint8_t *block = osPoolAlloc(&pool);
+
+			if (n == BLOCKS) {
+				CHECK(block == 0);
+				failed++;
+			} else {
+				held[n++] = block;
+				checkBlocks(held, n);
+				memset(block, 0xA5, BLOCK_SIZE);
+			}
+		} else if (n > 0) {
+			k = rnd(n);
+			CHECK(osPoolFree(&pool, held[k]) == 1);
+			held[k] = held[--n];
+		}
+		if ((uint32_t)n > maxUsed)
+			maxUsed = n;
+		if (i % 1000 == 0)
+			checkStats(n, maxUsed, failed);
+	}
+	checkStats(n, maxUsed, failed);
+	CHECK(maxUsed == BLOCKS);
+}
+
+static void refusedFree(void){
+	uint8_t *a, *b;
+	uint32_t other[4];
+
+	osPoolInit(&pool, storage, BLOCK_SIZE, BLOCKS);
+
+	// nothing allocated yet
+	CHECK(osPoolFree(&pool, storage) == 0);
+	checkStats(0, 0, 0);
+
+	a = osPoolAlloc(&pool);
+	b = osPoolAlloc(&pool);
+
+	// not the start of a block of this pool
+	CHECK(osPoolFree(&pool, a + 4) == 0);
+	CHECK(osPoolFree(&pool, (uint8_t *)storage + sizeof(storage)) == 0);
+	CHECK(osPoolFree(&pool, (uint8_t *)storage - pool.blockSize) == 0);
+	CHECK(osPoolFree(&pool, other) == 0);
+	checkStats(2, 2, 0);
+
+	// the same block twice in a row
+	CHECK(osPoolFree(&pool, b) == 1);
+	CHECK(osPoolFree(&pool, b) == 0);
+	checkStats(1, 2, 0);
+
+	// and once everything is back
+	CHECK(osPoolFree(&pool, a) == 1);
+	CHECK(osPoolFree(&pool, b) == 0);
+	checkStats(0, 2, 0);
+
+	// the free list is still sound
+	CHECK(osPoolAlloc(&pool) == a);
+	CHECK(osPoolAlloc(&pool) == b);
+	checkStats(2, 2, 0);
+}
+
+int main(void){
+	int failed = 0;
+
+	failed += simCase("exhaust", exhaust);
+	failed += simCase("scrambled frees", scrambledFree);
+	failed += simCase("fragmentation", fragment);
+	failed += simCase("refused frees", refusedFree);
+
+	return failed != 0;
+}
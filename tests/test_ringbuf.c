@@ -0,0 +1,173 @@
+/*
+ * SPSC ring: index wrap at 2^32, partial copies, and a producer and a
+ * consumer thread hammering one ring.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include "sim.h"
+#include "ringbuf.h"
+
+#define SIZE		64
+#define STRESS_BYTES	(64u << 20)
+
+// in the stress test the side that cannot make progress yields; on a
+// single CPU every spin would cost a whole time slice
+
+static ringBuf_t rb;
+static uint8_t buf[SIZE];
+
+// the byte stream: not periodic in the ring size, so a slip shows
+static uint8_t streamByte(uint32_t n){
+	return (uint8_t)(n ^ (n >> 7) ^ (n >> 13));
+}
+
+static uint32_t seed;
+
+static uint32_t rnd(uint32_t limit){
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % limit;
+}
+
+// both indices a little short of 2^32
+static void seedNearWrap(uint32_t before){
+	ringInit(&rb, buf, SIZE);
+	rb.head = 0 - before;
+	rb.tail = 0 - before;
+}
+
+static void indexWrap(void){
+	uint32_t n, out = 0;
+	uint8_t c = 0;
+	int i;
+
+	seedNearWrap(3 * SIZE / 2);
+	CHECK(ringCount(&rb) == 0);
+	CHECK(ringSpace(&rb) == SIZE);
+
+	// fill and drain across the wrap of both indices
+	for (i = 0; i < 4; i++) {
+		for (n = 0; n < SIZE; n++)
+			CHECK(ringPut(&rb, streamByte(out + n)));
+		CHECK(ringCount(&rb) == SIZE);
+		CHECK(ringSpace(&rb) == 0);
+		CHECK(!ringPut(&rb, 0));
+		for (n = 0; n < SIZE; n++) {
+			CHECK(ringGet(&rb, &c));
+			CHECK(c == streamByte(out + n));
+		}
+		CHECK(!ringGet(&rb, &c));
+		out += SIZE;
+	}
+	CHECK(rb.head < SIZE * 4);
+	CHECK(rb.head == rb.tail);
+}
+
+static void partialCopies(void){
+	uint8_t data[SIZE * 2], got[SIZE * 2];
+	uint32_t n;
+
+	for (n = 0; n < sizeof(data); n++)
+		data[n] = streamByte(n);
+	seedNearWrap(10);
+
+	// more than fits: only the free space is taken
+	CHECK(ringWrite(&rb, data, SIZE + 20) == SIZE);
+	CHECK(ringWrite(&rb, data, 1) == 0);
+	CHECK(ringRead(&rb, got, 5) == 5);
+	CHECK(ringWrite(&rb, data + SIZE, 20) == 5);
+
+	// more than there is: only what is queued comes out, in order and
+	// across the end of the buffer
+	CHECK(ringRead(&rb, got + 5, SIZE * 2) == SIZE);
+	for (n = 0; n < SIZE; n++)
+		CHECK(got[n] == data[n]);
+	for (n = 0; n < 5; n++)
+		CHECK(got[SIZE + n] == data[SIZE + n]);
+	CHECK(ringRead(&rb, got, 1) == 0);
+	CHECK(ringCount(&rb) == 0);
+}
+
+static void *producer(void *arg){
+	uint8_t chunk[SIZE * 2];
+	uint32_t sent = 0, len, n;
+
+	seed = 1;
+	while (sent < STRESS_BYTES) {
+		len = rnd(sizeof(chunk)) + 1;
+		if (len > STRESS_BYTES - sent)
+			len = STRESS_BYTES - sent;
+		if (len <= 4) {
+			// byte at a time
+			for (n = 0; n < len; ) {
+				if (ringPut(&rb, streamByte(sent + n)))
+					n++;
+				else
+					sched_yield();
+			}
+		} else {
+			// a block that may only partly fit; send the rest later
+			for (n = 0; n < len; n++)
+				chunk[n] = streamByte(sent + n);
+			len = ringWrite(&rb, chunk, len);
+			if (len == 0)
+				sched_yield();
+		}
+		sent += len;
+	}
+	return 0;
+}
+
+static void stress(void){
+	pthread_t thread;
+	uint8_t chunk[SIZE * 2];
+	uint32_t got = 0, len, n, count;
+	uint32_t seed2 = 7;
+	uint8_t c;
+
+	seedNearWrap(1000);
+	CHECK(pthread_create(&thread, 0, producer, 0) == 0);
+
+	while (got < STRESS_BYTES && simFailures == 0) {
+		count = ringCount(&rb);
+		CHECK(count <= SIZE);
+		seed2 = seed2 * 1103515245 + 12345;
+		if ((seed2 >> 8) % 4 == 0) {
+			if (ringGet(&rb, &c)) {
+				CHECK(c == streamByte(got));
+				got++;
+			} else {
+				sched_yield();
+			}
+		} else {
+			len = ringRead(&rb, chunk, (seed2 >> 12) % sizeof(chunk) + 1);
+			for (n = 0; n < len; n++) {
+				if (chunk[n] != streamByte(got + n)) {
+					CHECK(chunk[n] == streamByte(got + n));
+					break;
+				}
+			}
+			got += len;
+			if (len == 0)
+				sched_yield();
+		}
+	}
+	// after a mismatch the producer is left blocked on a full ring
+	if (simFailures != 0)
+		return;
+	CHECK(pthread_join(thread, 0) == 0);
+	CHECK(got == STRESS_BYTES);
+	CHECK(ringCount(&rb) == 0);
+	// both indices went through 2^32
+	CHECK(rb.head == STRESS_BYTES - 1000);
+}
+
+int main(void){
+	int failed = 0;
+
+	failed += simCase("index wrap", indexWrap);
+	failed += simCase("partial copies", partialCopies);
+	failed += simCase("two-thread stress", stress);
+
+	return failed != 0;
+}
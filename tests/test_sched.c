@@ -0,0 +1,242 @@
+/*
+ * Scheduler dispatch decisions: priority order, round robin within a
+ * level and preemption by new and woken tasks.
+ */
+
+#include "sim.h"
+
+static void taskFunc(void *args){
+}
+
+static uint8_t spawn(uint8_t priority, uint32_t timeSlice){
+	uint8_t id = createTask(taskFunc, 0, priority, timeSlice, RTOS_MIN_STACK_SIZE, 0);
+
+	CHECK(id != 0);
+	return id;
+}
+
+static void bootState(void){
+	simBoot();
+
+	CHECK(currentTask == &tcbList[0]);
+	CHECK(tcbList[0].state == running);
+	CHECK(tcbList[0].priority == RTOS_MAIN_PRIORITY);
+	// the idle task is below main and must not preempt it
+	CHECK(tcbList[1].state == ready);
+	CHECK(tcbList[1].priority == RTOS_IDLE_PRIORITY);
+	CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	simRun();
+	CHECK(currentTask == &tcbList[0]);
+
+	// no such task
+	CHECK(getStackHighWater(RTOS_MAX_TASKS - 1) == 0);
+	CHECK(getStackHighWater(RTOS_MAX_TASKS) == 0);
+	CHECK(getStackHighWater(0xFF) == 0);
+}
+
+static void createPreempts(void){
+	uint8_t low, high, peer;
+
+	simBoot();
+
+	// below main: queued, no switch requested
+	low = spawn(RTOS_MAIN_PRIORITY - 1, 0);
+	CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	CHECK(nextTask == &tcbList[0]);
+	CHECK(tcbList[low].state == ready);
+
+	// above main: switched to as soon as the caller lets interrupts in
+	high = spawn(5, 0);
+	CHECK(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk);
+	CHECK(nextTask == &tcbList[high]);
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+	CHECK(tcbList[high].state == running);
+	CHECK(tcbList[0].state == ready);
+
+	// same level as the caller: it waits for its turn
+	peer = spawn(5, 0);
+	CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+	CHECK(tcbList[peer].state == ready);
+}
+
+static void priorityOrder(void){
+	uint8_t t2, t3, t4;
+
+	simBoot();
+
+	// created low to high and out of order; the highest goes first
+	t2 = spawn(2, 0);
+	t4 = spawn(4, 0);
+	t3 = spawn(3, 0);
+	CHECK(nextTask == &tcbList[t4]);
+	simRun();
+	CHECK(currentTask == &tcbList[t4]);
+
+	// each task sleeps as it gets the CPU, handing down the levels
+	osDelay(3);
+	simRun();
+	CHECK(currentTask == &tcbList[t3]);
+	CHECK(tcbList[t4].state == waiting);
+	osDelay(5);
+	simRun();
+	CHECK(currentTask == &tcbList[t2]);
+	osDelay(10);
+	simRun();
+	CHECK(currentTask == &tcbList[0]);
+	osDelay(20);
+	simRun();
+	CHECK(currentTask == &tcbList[1]);
+
+	// and as they wake they preempt whatever runs below them
+	simTick();
+	simTick();
+	CHECK(currentTask == &tcbList[1]);
+	simTick();
+	CHECK(msTicks == 3);
+	CHECK(currentTask == &tcbList[t4]);
+	CHECK(tcbList[1].state == ready);
+	osDelay(100);
+	simRun();
+	CHECK(currentTask == &tcbList[1]);
+	simTick();
+	simTick();
+	CHECK(currentTask == &tcbList[t3]);
+	osDelay(100);
+	simRun();
+	while (msTicks < 10)
+		simTick();
+	CHECK(currentTask == &tcbList[t2]);
+	osDelay(100);
+	simRun();
+	while (msTicks < 19)
+		simTick();
+	CHECK(currentTask == &tcbList[1]);
+	simTick();
+	CHECK(currentTask == &tcbList[0]);
+}
+
+static void roundRobin(void){
+	uint8_t a, b, c, d;
+	uint8_t expect[12];
+	int i;
+
+	simBoot();
+
+	a = spawn(3, 1);
+	b = spawn(3, 1);
+	c = spawn(3, 1);
+	simRun();
+	CHECK(currentTask == &tcbList[a]);
+
+	// one tick each, in the order they were made ready
+	expect[0] = b;
+	expect[1] = c;
+	expect[2] = a;
+	for (i = 0; i < 6; i++) {
+		simTick();
+		CHECK(currentTask == &tcbList[expect[i % 3]]);
+	}
+
+	// a longer quantum keeps the CPU for that many ticks
+	d = spawn(3, 2);
+	// d joins the level behind c
+	expect[0] = b;
+	expect[1] = c;
+	expect[2] = d;
+	expect[3] = d;
+	expect[4] = a;
+	expect[5] = b;
+	expect[6] = c;
+	expect[7] = d;
+	expect[8] = d;
+	expect[9] = a;
+	for (i = 0; i < 10; i++) {
+		simTick();
+		CHECK(currentTask == &tcbList[expect[i]]);
+	}
+
+	// main and idle never got a look in
+	CHECK(tcbList[0].state == ready);
+	CHECK(tcbList[1].state == ready);
+}
+
+static void aloneKeepsCPU(void){
+	uint32_t avoided;
+	int i;
+
+	simBoot();
+
+	// main is alone at the top: ticks leave it running without a switch
+	avoided = switchesAvoided;
+	for (i = 0; i < 5; i++) {
+		simCycles(simCyclesToTick());
+		SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+		SysTick_Handler();
+		CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	}
+	CHECK(switchesAvoided == avoided + 5);
+	CHECK(currentTask == &tcbList[0]);
+}
+
+static void parkedTask(void){
+	uint8_t id;
+
+	simBoot();
+
+	// run-to-completion: parked until activated
+	id = createTask(taskFunc, 0, 4, 0, RTOS_MIN_STACK_SIZE, RTOS_TASK_RUN_TO_COMPLETION);
+	CHECK(id != 0);
+	CHECK(tcbList[id].state == waiting);
+	CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	simTick();
+	CHECK(currentTask == &tcbList[0]);
+
+	activateTask(id);
+	CHECK(nextTask == &tcbList[id]);
+	simRun();
+	CHECK(currentTask == &tcbList[id]);
+	CHECK(!(tcbList[id].flags & TASK_NOFRAME));
+
+	// activated again while busy: queued for when this run returns
+	activateTask(id);
+	CHECK(tcbList[id].activations == 1);
+}
+
+static void activateWithSwitchPending(void){
+	uint8_t low, high, parked;
+
+	simBoot();
+	low = spawn(2, 0);
+	parked = createTask(taskFunc, 0, 3, 0, RTOS_MIN_STACK_SIZE, RTOS_TASK_RUN_TO_COMPLETION);
+	CHECK(parked != 0);
+	high = spawn(4, 0);
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+
+	// high blocks and the switch down to low is pending when an
+	// interrupt comes in first and activates a task between the two
+	osDelay(100);
+	CHECK(nextTask == &tcbList[low]);
+	CHECK(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk);
+	activateTask(parked);
+	CHECK(nextTask == &tcbList[parked]);
+	simRun();
+	CHECK(currentTask == &tcbList[parked]);
+}
+
+int main(void){
+	int failed = 0;
+
+	failed += simCase("boot state", bootState);
+	failed += simCase("createTask preempts", createPreempts);
+	failed += simCase("priority order", priorityOrder);
+	failed += simCase("round robin", roundRobin);
+	failed += simCase("alone keeps the CPU", aloneKeepsCPU);
+	failed += simCase("run-to-completion task", parkedTask);
+	failed += simCase("activation with a switch pending", activateWithSwitchPending);
+
+	return failed != 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Counting semaphores: wake order, direct hand-off and timeouts.
+ */
+
+#include "sim.h"
+#include "semaphore.h"
+
+static osSem_t sem;
+
+static void taskFunc(void *args){
+}
+
+// create a task that blocks on sem as soon as it runs; main gets the CPU
+// back, so priority must be above main's
+static uint8_t waiter(uint8_t priority, uint32_t timeout){
+	uint8_t id = createTask(taskFunc, 0, priority, 0, RTOS_MIN_STACK_SIZE, 0);
+
+	CHECK(id != 0);
+	simRun();
+	CHECK(currentTask == &tcbList[id]);
+	osSemWait(&sem, timeout);
+	CHECK(tcbList[id].state == waiting);
+	simRun();
+	CHECK(currentTask == &tcbList[0]);
+	return id;
+}
+
+static uint8_t isWaiting(uint8_t id){
+	TCB_t *tcb = sem.waiters.head;
+
+	if (tcb == 0)
+		return 0;
+	do {
+		if (tcb == &tcbList[id])
+			return 1;
+		tcb = tcb->next;
+	} while (tcb != sem.waiters.head);
+	return 0;
+}
+
+static void wakeOrder(void){
+	uint8_t low, mid1, high, mid2;
+	uint8_t expect[4];
+	int i, j;
+
+	simBoot();
+	osSemInit(&sem, 0);
+
+	low = waiter(2, OS_WAIT_FOREVER);
+	mid1 = waiter(3, OS_WAIT_FOREVER);
+	high = waiter(4, OS_WAIT_FOREVER);
+	mid2 = waiter(3, OS_WAIT_FOREVER);
+
+	// highest priority first, first come first served among equals
+	expect[0] = high;
+	expect[1] = mid1;
+	expect[2] = mid2;
+	expect[3] = low;
+	CHECK(sem.waiters.head == &tcbList[high]);
+
+	// a burst of signals, e.g. from an interrupt handler, before any of
+	// the woken tasks gets to run
+	for (i = 0; i < 4; i++) {
+		osSemSignal(&sem);
+		for (j = 0; j < 4; j++) {
+			if (j <= i) {
+				CHECK(tcbList[expect[j]].state == ready);
+				CHECK(tcbList[expect[j]].waitResult == 1);
+				CHECK(!isWaiting(expect[j]));
+			} else {
+				CHECK(tcbList[expect[j]].state == waiting);
+				CHECK(isWaiting(expect[j]));
+			}
+		}
+		// each unit went to a task, none to the count
+		CHECK(sem.count == 0);
+	}
+	CHECK(sem.waiters.head == 0);
+
+	// and they then run in priority order
+	CHECK(nextTask == &tcbList[high]);
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+}
+
+static void directHandoff(void){
+	uint8_t id;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	id = waiter(3, OS_WAIT_FOREVER);
+
+	// the unit is the waiter's before it runs: main cannot take it
+	osSemSignal(&sem);
+	CHECK(sem.count == 0);
+	CHECK(tcbList[id].state == ready);
+	CHECK(osSemWait(&sem, OS_NO_WAIT) == 0);
+	simRun();
+	CHECK(currentTask == &tcbList[id]);
+
+	// with nobody waiting the count goes up, and a wait takes it at once
+	osSemSignal(&sem);
+	osSemSignal(&sem);
+	CHECK(sem.count == 2);
+	CHECK(osSemWait(&sem, OS_WAIT_FOREVER) == 1);
+	CHECK(sem.count == 1);
+	CHECK(currentTask == &tcbList[id]);
+}
+
+static void noSwitchForLower(void){
+	uint8_t low, high;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	low = waiter(2, OS_WAIT_FOREVER);
+	high = createTask(taskFunc, 0, 5, 0, RTOS_MIN_STACK_SIZE, 0);
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+
+	// the woken task does not outrank the signaller: no switch
+	osSemSignal(&sem);
+	CHECK(tcbList[low].state == ready);
+	CHECK(!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk));
+	simRun();
+	CHECK(currentTask == &tcbList[high]);
+}
+
+static void timeout(void){
+	uint8_t a, b, c;
+	int i;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	a = waiter(3, OS_WAIT_FOREVER);
+	b = waiter(3, 3);
+	c = waiter(3, OS_WAIT_FOREVER);
+
+	for (i = 0; i < 2; i++) {
+		simTick();
+		CHECK(tcbList[b].state == waiting);
+	}
+	// timed out: off the list, returns 0
+	simTick();
+	CHECK(tcbList[b].state != waiting);
+	CHECK(tcbList[b].waitResult == 0);
+	CHECK(!isWaiting(b));
+	CHECK(isWaiting(a));
+	CHECK(isWaiting(c));
+	simRun();
+	CHECK(currentTask == &tcbList[b]);
+	osDelay(1000);
+	simRun();
+	CHECK(currentTask == &tcbList[0]);
+
+	// the rest of the list is intact and in order
+	osSemSignal(&sem);
+	CHECK(tcbList[a].state == ready);
+	CHECK(tcbList[c].state == waiting);
+	osSemSignal(&sem);
+	CHECK(tcbList[c].state == ready);
+	CHECK(sem.waiters.head == 0);
+	osSemSignal(&sem);
+	CHECK(sem.count == 1);
+}
+
+static void signalInTime(void){
+	uint8_t id;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	id = waiter(3, 2);
+
+	// signalled in time: the delay is cancelled with it
+	simTick();
+	osSemSignal(&sem);
+	CHECK(tcbList[id].waitResult == 1);
+	CHECK(!(tcbList[id].flags & TASK_TIMED));
+	simRun();
+	CHECK(currentTask == &tcbList[id]);
+	simTick();
+	simTick();
+	CHECK(currentTask == &tcbList[id]);
+	CHECK(tcbList[id].waitResult == 1);
+}
+
+int main(void){
+	int failed = 0;
+
+	failed += simCase("wake order", wakeOrder);
+	failed += simCase("direct hand-off", directHandoff);
+	failed += simCase("no switch for a lower waiter", noSwitchForLower);
+	failed += simCase("timeout leaves the list", timeout);
+	failed += simCase("signal before the timeout", signalInTime);
+
+	return failed != 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * RTOS_TICKLESS: msTicks has to follow wall time however SysTick was
+ * stretched, resynchronised early or caught with its interrupt pending.
+ */
+
+#include "sim.h"
+#include "semaphore.h"
+
+#define TICK	(SystemCoreClock / RTOS_TICK_HZ)
+
+// ticks of wall time since boot
+#define wallTicks()	((uint32_t)(simClock / TICK))
+
+static osSem_t sem;
+static uint32_t seed = 12345;
+
+static uint32_t rnd(uint32_t limit){
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % limit;
+}
+
+static void taskFunc(void *args){
+}
+
+// tick until tcb gets the CPU, for at most limit interrupts
+static void tickUntil(TCB_t *tcb, uint32_t limit){
+	while (currentTask != tcb && limit-- > 0)
+		simTick();
+	CHECK(currentTask == tcb);
+}
+
+// a task blocked on sem, for an "interrupt" to wake early
+static uint8_t waiterTask(void){
+	uint8_t id = createTask(taskFunc, 0, 2, 0, RTOS_MIN_STACK_SIZE, 0);
+
+	simRun();
+	CHECK(currentTask == &tcbList[id]);
+	osSemWait(&sem, OS_WAIT_FOREVER);
+	simRun();
+	CHECK(currentTask == &tcbList[0]);
+	return id;
+}
+
+static void maxStretches(void){
+	uint32_t start;
+	int i;
+
+	simBoot();
+
+	// only idle left: every period is as long as the counter allows
+	osDelay(200000);
+	simRun();
+	CHECK(currentTask == &tcbList[1]);
+	simTick();
+	CHECK(msTicks == 1);
+	for (i = 0; i < 1000; i++) {
+		start = msTicks;
+		simTick();
+		CHECK(msTicks - start == (SysTick_LOAD_RELOAD_Msk + 1) / TICK);
+		CHECK(msTicks == wallTicks());
+	}
+
+	// and main still wakes on time
+	tickUntil(&tcbList[0], 1000);
+	CHECK(msTicks == 200000);
+	CHECK(wallTicks() == 200000);
+}
+
+static void earlyResync(void){
+	uint8_t waiter;
+	int i;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	waiter = waiterTask();
+	osDelay(0x40000000);
+	simRun();
+	CHECK(currentTask == &tcbList[1]);
+
+	for (i = 0; i < 2000; i++) {
+		// into a stretch, then part of the way through it
+		simTick();
+		CHECK(msTicks == wallTicks());
+		simCycles(rnd(simCyclesToTick() - 1) + 1);
+
+		if (i % 2 == 0) {
+			// an interrupt readies the waiter, which ends the stretch
+			osSemSignal(&sem);
+			CHECK(msTicks == wallTicks());
+			simRun();
+			CHECK(currentTask == &tcbList[waiter]);
+			osSemWait(&sem, OS_WAIT_FOREVER);
+			simRun();
+		} else {
+			// a timestamp taken in passing, then a task reads the time
+			CHECK(tickNow() == wallTicks());
+			CHECK(osTickCount() == wallTicks());
+		}
+		CHECK(currentTask == &tcbList[1]);
+	}
+}
+
+static void resyncAtExpiry(void){
+	uint8_t waiter;
+	uint32_t late, now;
+	int i;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	waiter = waiterTask();
+	osDelay(0x40000000);
+	simRun();
+
+	for (i = 0; i < 200; i++) {
+		simTick();
+		// run to the end of the stretch, or a little past it, with the
+		// interrupt held off
+		late = rnd(3) == 0 ? rnd(1000) : 0;
+		simCycles(simCyclesToTick() + late);
+		CHECK(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk);
+
+		if (i % 2 == 0) {
+			osSemSignal(&sem);
+			CHECK(msTicks == wallTicks());
+			// the handler must not count the stretch a second time
+			simRun();
+			CHECK(msTicks == wallTicks());
+			CHECK(currentTask == &tcbList[waiter]);
+			osSemWait(&sem, OS_WAIT_FOREVER);
+			simRun();
+		} else {
+			CHECK(tickNow() == wallTicks());
+			CHECK(osTickCount() == wallTicks());
+			simRun();
+			CHECK(msTicks == wallTicks());
+		}
+	}
+
+	// a delay started right at the expiry counts from the real time
+	simTick();
+	simCycles(simCyclesToTick());
+	osSemSignal(&sem);
+	simRun();
+	CHECK(currentTask == &tcbList[waiter]);
+	now = osTickCount();
+	CHECK(now == wallTicks());
+	osDelay(10);
+	simRun();
+	tickUntil(&tcbList[waiter], 10);
+	CHECK(msTicks == now + 10);
+	CHECK(wallTicks() == now + 10);
+}
+
+static void resyncNearBoundary(void){
+	uint8_t waiter;
+	uint32_t r, now;
+
+	simBoot();
+	osSemInit(&sem, 0);
+	waiter = waiterTask();
+	osDelay(0x40000000);
+	simRun();
+
+	// resync a few cycles short of a tick boundary, down to the last
+	// cycle of the tick, where the rest of the tick is no period at all
+	for (r = 1; r <= 32; r++) {
+		simTick();
+		simCycles((TICK - r + TICK - simClock % TICK) % TICK);
+		CHECK(simClock % TICK == TICK - r);
+
+		osSemSignal(&sem);
+		CHECK(SysTick->LOAD != 0);
+		CHECK(msTicks == wallTicks());
+		// the tick keeps going
+		simTick();
+		CHECK(msTicks == wallTicks());
+		tickUntil(&tcbList[waiter], 2);
+		osSemWait(&sem, OS_WAIT_FOREVER);
+		simRun();
+		CHECK(currentTask == &tcbList[1]);
+	}
+
+	// and delays still expire
+	simTick();
+	simCycles((TICK - 1 + TICK - simClock % TICK) % TICK);
+	osSemSignal(&sem);
+	simRun();
+	CHECK(currentTask == &tcbList[waiter]);
+	now = osTickCount();
+	osDelay(10);
+	simRun();
+	tickUntil(&tcbList[waiter], 10);
+	CHECK(msTicks == now + 10);
+	CHECK(wallTicks() == now + 10);
+}
+
+int main(void){
+	int failed = 0;
+
+	failed += simCase("repeated maximum stretches", maxStretches);
+	failed += simCase("early resyncs", earlyResync);
+	failed += simCase("resync with the expiry pending", resyncAtExpiry);
+	failed += simCase("resync in the last cycles of a tick", resyncNearBoundary);
+
+	return failed != 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Software timers. Active timers are kept in a list sorted by expiry,
+ * and the service task sleeps on a semaphore with a timeout set to the
+ * head's expiry, so the tick handler only ever looks at the head of the
+ * kernel's delay list and tickless mode stretches up to the next
+ * timer. Callbacks run in the service task, one at a time, and may
+ * block or start and stop timers, but a long one delays the rest.
+ */
+
+#include "timer.h"
+#include "semaphore.h"
+
+static osTimer_t *timerList = 0;
+static osSem_t timerSem;	// signalled when the head of timerList changes
+static uint8_t timerTaskID = 0;
+
+// call with interrupts disabled
+static void timerInsert(osTimer_t *timer){
+	osTimer_t **link = &timerList;
+
+	// after any timer due at the same tick, so equal timers fire in order
+	while (*link != 0 && (int32_t)((*link)->expiry - timer->expiry) <= 0) {
+		link = &(*link)->next;
+	}
+	timer->next = *link;
+	*link = timer;
+	timer->active = 1;
+}
+
+// call with interrupts disabled
+static void timerRemove(osTimer_t *timer){
+	osTimer_t **link = &timerList;
+
+	while (*link != timer) {
+		link = &(*link)->next;
+	}
+	*link = timer->next;
+	timer->next = 0;
+	timer->active = 0;
+}
+
+static void timerTask(void *args){
+	osTimer_t *timer;
+	uint32_t primask, now, wait;
+
+	while (1) {
+		primask = enterCritical();
+		now = osTickCount();
+		timer = timerList;
+		if (timer != 0 && (int32_t)(now - timer->expiry) >= 0) {
+			timerRemove(timer);
+			// reload from the expiry, not from now, so periods do not drift
+			if (timer->period != 0) {
+				timer->expiry += timer->period;
+				timerInsert(timer);
+			}
+			exitCritical(primask);
+			timer->func(timer->arg);
+			continue;
+		}
+		wait = (timer != 0 ? timer->expiry - now : OS_WAIT_FOREVER);
+		exitCritical(primask);
+
+		// a timer started in between has signalled, so this returns at once
+		osSemWait(&timerSem, wait);
+	}
+}
+
+// create the service task; call after init(). returns its task ID, 0 if
+// it could not be created
+uint8_t osTimerServiceStart(void){
+	if (timerTaskID == 0) {
+		osSemInit(&timerSem, 0);
+		timerTaskID = createTask(timerTask, 0, RTOS_TIMER_PRIORITY, 0,
+			RTOS_TIMER_STACK_SIZE, 0);
+	}
+	return timerTaskID;
+}
+
+void osTimerInit(osTimer_t *timer, osTimerFunc_t func, void *arg){
+	timer->next = 0;
+	timer->func = func;
+	timer->arg = arg;
+	timer->expiry = 0;
+	timer->period = 0;
+	timer->active = 0;
+}
+
+// fire func after delay ticks, then every period ticks unless period is
+// 0; restarts a timer that is already running. safe to call from
+// interrupt handlers
+void osTimerStart(osTimer_t *timer, uint32_t delay, uint32_t period){
+	uint32_t primask = enterCritical();
+
+	if (timer->active)
+		timerRemove(timer);
+	timer->expiry = osTickCount() + delay;
+	timer->period = period;
+	timerInsert(timer);
+	// the service task is sleeping until the old head
+	if (timerList == timer)
+		osSemSignal(&timerSem);
+	exitCritical(primask);
+}
+
+void osTimerStop(osTimer_t *timer){
+	uint32_t primask = enterCritical();
+
+	if (timer->active)
+		timerRemove(timer);
+	exitCritical(primask);
+}
@@ -0,0 +1,26 @@
+/*
+ * software timer header file
+ */
+#ifndef __timer_h
+#define __timer_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+typedef void (*osTimerFunc_t)(void *arg);
+
+typedef struct osTimer {
+	struct osTimer *next;	// in the active list, soonest first
+	osTimerFunc_t func;
+	void *arg;
+	uint32_t expiry;	// msTicks at which it fires
+	uint32_t period;	// reload interval, 0 for one-shot
+	uint8_t active;
+} osTimer_t;
+
+uint8_t osTimerServiceStart(void);
+void osTimerInit(osTimer_t *timer, osTimerFunc_t func, void *arg);
+void osTimerStart(osTimer_t *timer, uint32_t delay, uint32_t period);
+void osTimerStop(osTimer_t *timer);
+
+#endif
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Decode the binary stream written by dlogTask() (dlog.c).
+
+Format strings are not sent; each record carries the address of its
+string, which is looked up in the image the target was built from:
+
+    dlog_decode.py Objects/RTOS.axf capture.bin
+    dlog_decode.py Objects/RTOS.axf /dev/ttyUSB1      # port set up with stty
+    dlog_decode.py --clock 100000000 Objects/RTOS.axf - < capture.bin
+
+Each line shows msTicks, the cycle counter (or microseconds since the
+first record when --clock is given) and the formatted message.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+DLOG_MAGIC = 0xD10C
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcspn%])")
+
+
+class Image:
+    """The initialised, allocated parts of an ELF32 image, by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a little-endian ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.ranges = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.ranges.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        for base, blob in self.ranges:
+            if base <= addr < base + len(blob):
+                end = blob.find(b"\0", addr - base)
+                if end < 0:
+                    end = len(blob)
+                return blob[addr - base:end].decode("latin-1")
+        return None
+
+
+def format_message(image, fmt, args):
+    """printf with 32-bit arguments; %s arguments are string addresses."""
+    args = list(args)
+    out = []
+    pos = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if not args:
+            out.append(m.group(0))
+            continue
+        value = args.pop(0)
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+            out.append(("%" + flags + "d") % value)
+        elif conv == "c":
+            out.append(("%" + flags + "c") % chr(value & 0xFF))
+        elif conv == "s":
+            s = image.string(value)
+            out.append(("%" + flags + "s") % (s if s is not None else "<0x%08x>" % value))
+        elif conv == "p":
+            out.append("0x%08x" % value)
+        elif conv == "n":
+            pass
+        else:
+            out.append(("%" + flags + conv) % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def records(stream):
+    """Yield (dropped, fmt address, msTicks, cycles, args), resynchronising
+    on the header magic after a gap or garbage in the stream."""
+    buf = b""
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while len(buf) >= 16:
+            header, = struct.unpack_from("<I", buf, 0)
+            nargs = (header >> 8) & 0xFF
+            if header >> 16 != DLOG_MAGIC or nargs > 4:
+                buf = buf[1:]
+                continue
+            size = 16 + 4 * nargs
+            if len(buf) < size:
+                break
+            words = struct.unpack_from("<%dI" % (size // 4), buf, 0)
+            buf = buf[size:]
+            yield header & 0xFF, words[1], words[2], words[3], words[4:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="the .axf the target is running")
+    parser.add_argument("stream", help="captured stream, serial device or - for stdin")
+    parser.add_argument("--clock", type=int, help="core clock in Hz, to show microseconds")
+    opts = parser.parse_args()
+
+    image = Image(opts.image)
+    stream = sys.stdin.buffer if opts.stream == "-" else open(opts.stream, "rb", buffering=0)
+
+    first = None
+    elapsed = 0
+    for dropped, addr, ticks, cycles, args in records(stream):
+        if dropped:
+            print("-- %d record(s) dropped%s --" % (dropped, "+" if dropped == 0xFF else ""))
+        fmt = image.string(addr)
+        if fmt is None:
+            msg = "<unknown format 0x%08x> %s" % (addr, " ".join("0x%08x" % a for a in args))
+        else:
+            msg = format_message(image, fmt, args).rstrip("\n")
+        if opts.clock:
+            # the cycle counter wraps every few tens of seconds
+            if first is not None:
+                elapsed += (cycles - first) & 0xFFFFFFFF
+            first = cycles
+            stamp = "%12.1fus" % (elapsed * 1e6 / opts.clock)
+        else:
+            stamp = "%10u" % cycles
+        print("%10u %s  %s" % (ticks, stamp, msg))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""Convert the kernel trace written by traceTask() (trace.c) to Chrome
+trace / Perfetto JSON.
+
+The input is the raw word stream: a UART capture with TRACE_UART, or the
+stimulus port's data pulled out of the SWO stream (e.g. with orbcat):
+
+    trace2json.py capture.bin > trace.json
+    trace2json.py --clock 100000000 --names 0=main,1=idle - < capture.bin
+
+Open the result in ui.perfetto.dev or chrome://tracing. Each task gets a
+track with its running slices and a "ready" slice from every wake-up to
+the switch that ran it, i.e. the scheduling latency; each exception gets
+a track with its handler runs.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+SWITCH, CREATE, BLOCK, WAKE, ISR_ENTER, ISR_EXIT = range(6)
+SEM_SIGNAL, MUTEX_LOCK, MUTEX_UNLOCK, QUEUE_SEND, QUEUE_RECEIVE, EVENT_SET = range(6, 12)
+OVERFLOW = 0xF
+RESYNC = -1         # not on the wire: the stream was lost and found again
+
+SYNC = struct.pack("<II", 0xEE5AA55A, 0x5AA5C33C)   # TRACE_SYNC_INFO, _MAGIC
+
+OBJECT_EVENTS = {
+    SEM_SIGNAL: "sem signal",
+    MUTEX_LOCK: "mutex lock",
+    MUTEX_UNLOCK: "mutex unlock",
+    QUEUE_SEND: "queue send",
+    QUEUE_RECEIVE: "queue receive",
+    EVENT_SET: "event set",
+}
+
+# exception numbers of the handlers that are traced
+EXCEPTIONS = {15: "SysTick", 21: "UART0", 22: "UART1", 42: "DMA"}
+
+ISR_TID = 1000
+
+
+def events(stream):
+    """Yield (type, task, arg, cycles). Events are only taken once a sync
+    frame has put the reader in phase with the two-word frames, so a
+    capture that starts mid-event or on a timestamp word is skipped up to
+    the next flush. A frame without the 0xE marker means bytes were lost:
+    the reader drops out and waits for the next sync frame, and yields a
+    RESYNC event with no timestamp once it has one."""
+    buf = b""
+    locked = False
+    lost = False
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            if not locked:
+                at = buf.find(SYNC)
+                if at < 0:
+                    # keep what could be the start of a sync frame
+                    buf = buf[-(len(SYNC) - 1):]
+                    break
+                buf = buf[at + len(SYNC):]
+                locked = True
+                if lost:
+                    yield RESYNC, 0, 0, None
+                continue
+            if len(buf) < 8:
+                break
+            if buf[:8] == SYNC:
+                buf = buf[8:]
+                continue
+            info, stamp = struct.unpack_from("<II", buf, 0)
+            if info >> 28 != 0xE:
+                locked = False
+                lost = True
+                continue
+            buf = buf[8:]
+            yield (info >> 24) & 0xF, (info >> 16) & 0xFF, info & 0xFFFF, stamp
+
+
+class Converter:
+    def __init__(self, clock, names):
+        self.clock = clock
+        self.names = names
+        self.out = []
+        self.tasks = {}         # task ID -> priority, once seen
+        self.running = None     # (task, start)
+        self.woken = {}         # task ID -> time it was made ready
+        self.isrs = []          # (exception, start) of nested handlers
+        self.known = 0          # time from which the running task is known
+        self.last = None
+        self.now = 0
+
+    def us(self, cycles):
+        return cycles * 1e6 / self.clock
+
+    def task(self, tid, priority=None):
+        if tid not in self.tasks or priority is not None:
+            self.tasks[tid] = priority
+
+    def slice(self, name, tid, start, end, args=None):
+        ev = {"name": name, "ph": "X", "pid": 0, "tid": tid,
+              "ts": self.us(start), "dur": self.us(end - start)}
+        if args:
+            ev["args"] = args
+        self.out.append(ev)
+
+    def instant(self, name, tid, args=None, scope="t"):
+        ev = {"name": name, "ph": "i", "s": scope, "pid": 0, "tid": tid, "ts": self.us(self.now)}
+        if args:
+            ev["args"] = args
+        self.out.append(ev)
+
+    def feed(self, kind, task, arg, stamp):
+        if kind == RESYNC:
+            # the timestamps still place what follows, unless the gap was
+            # longer than a wrap of the cycle counter
+            self.instant("stream lost", 0, scope="g")
+            self.reset()
+            return
+
+        # the cycle counter wraps every few tens of seconds
+        if self.last is not None:
+            self.now += (stamp - self.last) & 0xFFFFFFFF
+        self.last = stamp
+        now = self.now
+
+        if kind == SWITCH:
+            self.task(task)
+            self.task(arg)
+            start = self.running[1] if self.running and self.running[0] == task else self.known
+            self.slice("running", task, start, now)
+            if arg in self.woken:
+                t = self.woken.pop(arg)
+                self.slice("ready", arg, t, now, {"latency_us": round(self.us(now - t), 3)})
+            self.running = (arg, now)
+        elif kind == CREATE:
+            self.task(task, arg)
+            self.instant("create", task, {"priority": arg})
+        elif kind == BLOCK:
+            self.task(task)
+            self.instant("delay" if arg == 0 else "block", task,
+                         {"object": "0x%04x" % arg} if arg else None)
+        elif kind == WAKE:
+            self.task(task)
+            self.woken.setdefault(task, now)
+            self.instant("wake" if arg else "timeout", task)
+        elif kind == ISR_ENTER:
+            self.isrs.append((arg, now))
+        elif kind == ISR_EXIT:
+            # tolerate a trace that starts inside a handler
+            while self.isrs and self.isrs[-1][0] != arg:
+                self.isrs.pop()
+            start = self.isrs.pop()[1] if self.isrs else now
+            self.slice(EXCEPTIONS.get(arg, "exception %d" % arg), ISR_TID + arg, start, now)
+        elif kind in OBJECT_EVENTS:
+            self.task(task)
+            self.instant(OBJECT_EVENTS[kind], task, {"object": "0x%04x" % arg})
+        elif kind == OVERFLOW:
+            # state built up before the gap can no longer be trusted
+            self.instant("%d events lost" % arg, 0, scope="g")
+            self.reset()
+
+    def reset(self):
+        """Forget state built up before a gap, which can no longer be trusted."""
+        self.woken.clear()
+        self.isrs = []
+        self.running = None
+        self.known = self.now
+
+    def finish(self):
+        if self.running:
+            self.slice("running", self.running[0], self.running[1], self.now)
+        meta = []
+        for tid, priority in sorted(self.tasks.items()):
+            name = self.names.get(tid, "task %d" % tid)
+            if priority is not None:
+                name += " (prio %d)" % priority
+            meta.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid, "args": {"name": name}})
+            meta.append({"name": "thread_sort_index", "ph": "M", "pid": 0, "tid": tid,
+                         "args": {"sort_index": tid}})
+        for tid in sorted({e["tid"] for e in self.out if e["tid"] >= ISR_TID}):
+            exc = tid - ISR_TID
+            meta.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid,
+                         "args": {"name": EXCEPTIONS.get(exc, "exception %d" % exc)}})
+        meta.append({"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "rtos"}})
+        return {"traceEvents": meta + self.out, "displayTimeUnit": "ns"}
+
+
+def parse_names(text):
+    names = {}
+    for item in filter(None, (text or "").split(",")):
+        tid, _, name = item.partition("=")
+        names[int(tid)] = name
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("stream", help="captured trace, or - for stdin")
+    parser.add_argument("--clock", type=int, default=100000000,
+                        help="core clock in Hz (default 100 MHz)")
+    parser.add_argument("--names", help="task names, e.g. 0=main,1=idle")
+    parser.add_argument("-o", "--output", help="write here instead of stdout")
+    opts = parser.parse_args()
+
+    stream = sys.stdin.buffer if opts.stream == "-" else open(opts.stream, "rb")
+    conv = Converter(opts.clock, parse_names(opts.names))
+    for ev in events(stream):
+        conv.feed(*ev)
+
+    out = open(opts.output, "w") if opts.output else sys.stdout
+    json.dump(conv.finish(), out, indent=1)
+    out.write("\n")
+
+
+if __name__ == "__main__":
+    main()
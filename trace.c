@@ -0,0 +1,154 @@
+/*
+ * Kernel event trace. Events are two words copied into a ring with
+ * interrupts off, cheap enough to leave on in the scheduler and in
+ * interrupt handlers; traceTask() ships them out at low priority. A full
+ * ring drops new events and a TRACE_OVERFLOW event with the count goes
+ * in once there is room again.
+ */
+
+#include "trace.h"
+#ifdef TRACE_UART
+#include "uart.h"
+#endif
+
+#ifdef RTOS_TRACE
+
+#define TRACE_MASK	(TRACE_BUFSIZE - 1)
+
+uint32_t traceBuf[TRACE_BUFSIZE];
+volatile uint32_t traceHead;	// written by traceRecord with interrupts off
+volatile uint32_t traceTail;	// written by traceFlush only
+uint32_t traceLost;
+
+// the trace keeps its own work out of the stream: shipping the events
+// would otherwise record more than it sends. traceTask() runs unseen,
+// its CPU time going to the task it was switched in over
+static uint8_t traceSelf = 0xFF;	// task running traceTask()
+static uint8_t traceBehind;		// task it was switched in over
+
+#ifdef TRACE_UART
+// exception number of the trace port's UART handler
+#define TRACE_EXCEPTION	(16 + UART0_IRQn + TRACE_PORT)
+#endif
+
+// the cycle counter is started by init()
+void traceInit(void){
+#ifdef TRACE_UART
+	UARTInit(TRACE_PORT, TRACE_BAUD);
+#endif
+}
+
+static void tracePut(uint32_t info, uint32_t stamp){
+	traceBuf[traceHead & TRACE_MASK] = info;
+	traceBuf[(traceHead + 1) & TRACE_MASK] = stamp;
+	__DMB();	// event before index
+	traceHead += 2;
+}
+
+// whether an event is part of getting the trace out: anything the trace
+// task does itself, its wake-ups, and with TRACE_UART whatever the trace
+// port's handler does
+static uint32_t traceOwn(uint32_t type, uint32_t task){
+#ifdef TRACE_UART
+	if (__get_IPSR() == TRACE_EXCEPTION)
+		return 1;
+#endif
+	return (task == traceSelf && (type == TRACE_WAKE || __get_IPSR() == 0));
+}
+
+void traceRecord(uint32_t type, uint32_t task, uint32_t arg){
+	uint32_t primask, stamp, space;
+
+	if (traceOwn(type, task))
+		return;
+
+	primask = enterCritical();
+	stamp = DWT->CYCCNT;
+	space = TRACE_BUFSIZE - (traceHead - traceTail);
+
+	if (space < (traceLost != 0 ? 4 : 2)) {
+		traceLost++;
+		exitCritical(primask);
+		return;
+	}
+	if (traceLost != 0) {
+		tracePut(0xE0000000 | (TRACE_OVERFLOW << 24) | (traceLost > 0xFFFF ? 0xFFFF : traceLost), stamp);
+		traceLost = 0;
+	}
+	tracePut(0xE0000000 | (type << 24) | ((task & 0xFF) << 16) | (arg & 0xFFFF), stamp);
+	exitCritical(primask);
+}
+
+// called by PendSV_Handler before it switches to nextTask
+void traceSwitch(void){
+	if (nextTask == currentTask)
+		return;
+
+	if (nextTask->taskID == traceSelf) {
+		traceBehind = currentTask->taskID;
+	} else if (currentTask->taskID == traceSelf) {
+		// as if straight from the task the trace task interrupted
+		if (nextTask->taskID != traceBehind)
+			traceRecord(TRACE_SWITCH, traceBehind, nextTask->taskID);
+	} else {
+		traceRecord(TRACE_SWITCH, currentTask->taskID, nextTask->taskID);
+	}
+}
+
+static const uint32_t traceSync[2] = { TRACE_SYNC_INFO, TRACE_SYNC_MAGIC };
+
+static void traceSend(const uint32_t *words, uint32_t n){
+#ifdef TRACE_UART
+	// words go out in place, little-endian
+	UARTSendBlocking(TRACE_PORT, (uint8_t *)words, n * 4);
+#else
+	uint32_t i;
+
+	// no debugger listening: throw the events away
+	if ((ITM->TCR & ITM_TCR_ITMENA_Msk) && (ITM->TER & (1UL << TRACE_ITM_PORT))) {
+		for (i = 0; i < n; i++) {
+			while (ITM->PORT[TRACE_ITM_PORT].u32 == 0);
+			ITM->PORT[TRACE_ITM_PORT].u32 = words[i];
+		}
+	}
+#endif
+}
+
+// send everything recorded so far; returns the number of event words
+// sent. only one task may flush
+uint32_t traceFlush(void){
+	uint32_t tail = traceTail;
+	uint32_t count = traceHead - tail;
+	uint32_t n, sent = 0;
+
+	// a reader that joined mid-stream or lost bytes locks on here
+	if (count != 0)
+		traceSend(traceSync, 2);
+
+	while (count != 0) {
+		// up to the end of the buffer, then from the start
+		n = TRACE_BUFSIZE - (tail & TRACE_MASK);
+		if (n > count)
+			n = count;
+		traceSend(&traceBuf[tail & TRACE_MASK], n);
+		tail += n;
+		count -= n;
+		sent += n;
+		__DMB();	// done with the words before they are handed back
+		traceTail = tail;
+	}
+	return sent;
+}
+
+void traceTask(void *args){
+	// the switch in to here is already recorded
+	traceBehind = currentTask->taskID;
+	traceSelf = currentTask->taskID;
+
+	while (1) {
+		traceFlush();
+		osDelay(TRACE_PERIOD);
+	}
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * kernel event trace header file
+ *
+ * With RTOS_TRACE defined the kernel, the synchronization objects and the
+ * UART and DMA handlers record two-word events into a ring: an info word
+ * (0xE in the top nibble, event type, task ID, 16-bit argument) and
+ * DWT->CYCCNT. traceTask() streams them out, each batch behind a sync
+ * frame, and tools/trace2json.py turns them into Chrome trace / Perfetto
+ * JSON. Without RTOS_TRACE the hooks compile to nothing.
+ */
+#ifndef __trace_h
+#define __trace_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+// event types; objects are identified by the low 16 bits of their address
+#define TRACE_SWITCH		0x0	// task: outgoing, arg: incoming task
+#define TRACE_CREATE		0x1	// task: new task, arg: priority
+#define TRACE_BLOCK		0x2	// task: blocked, arg: object waited on, 0 for a delay
+#define TRACE_WAKE		0x3	// task: made ready, arg: result of its wait
+#define TRACE_ISR_ENTER		0x4	// arg: exception number
+#define TRACE_ISR_EXIT		0x5	// arg: exception number
+#define TRACE_SEM_SIGNAL	0x6	// arg: semaphore
+#define TRACE_MUTEX_LOCK	0x7	// arg: mutex, taken without waiting
+#define TRACE_MUTEX_UNLOCK	0x8	// arg: mutex
+#define TRACE_QUEUE_SEND	0x9	// arg: queue
+#define TRACE_QUEUE_RECEIVE	0xA	// arg: queue
+#define TRACE_EVENT_SET		0xB	// arg: event group
+#define TRACE_SYNC		0xE	// only in the sync frame below
+#define TRACE_OVERFLOW		0xF	// arg: events lost before this one
+
+// sent ahead of every batch of events. a reader locks on to the stream
+// where it finds these two words; out of phase, the second would have
+// to be an info word, which cannot start with 0x5
+#define TRACE_SYNC_INFO		0xEE5AA55Au
+#define TRACE_SYNC_MAGIC	0x5AA5C33Cu
+
+#ifdef RTOS_TRACE
+
+// words of trace buffer, a power of two; two per event
+#ifndef TRACE_BUFSIZE
+#define TRACE_BUFSIZE	512
+#endif
+
+// traceTask() writes to ITM stimulus port TRACE_ITM_PORT, for SWO; define
+// TRACE_UART to use UART port TRACE_PORT instead, which must not be the
+// one dlog uses
+#ifndef TRACE_ITM_PORT
+#define TRACE_ITM_PORT	2
+#endif
+#ifndef TRACE_PORT
+#define TRACE_PORT	1
+#endif
+// an event is 8 bytes, 10 bits a byte on the wire, and SysTick alone
+// makes 2000 events a second at a 1 kHz tick: 160 kbit/s before any
+// task does anything, more than 115200 baud can carry. the default is
+// PCLK/32 with the reset 25 MHz PCLK, which UARTInit's integer divider
+// hits exactly; a rate it cannot hit garbles the stream
+#ifndef TRACE_BAUD
+#define TRACE_BAUD	781250
+#endif
+
+// ticks traceTask() sleeps between flushes
+#ifndef TRACE_PERIOD
+#define TRACE_PERIOD	10
+#endif
+
+#if TRACE_BUFSIZE & (TRACE_BUFSIZE - 1)
+#error "TRACE_BUFSIZE must be a power of two"
+#endif
+
+void traceInit(void);
+void traceRecord(uint32_t type, uint32_t task, uint32_t arg);
+void traceSwitch(void);
+uint32_t traceFlush(void);
+void traceTask(void *args);
+
+#define trace(type, task, arg)	traceRecord((type), (task), (uint32_t)(arg))
+#define traceIsrEnter()		traceRecord(TRACE_ISR_ENTER, 0, __get_IPSR())
+#define traceIsrExit()		traceRecord(TRACE_ISR_EXIT, 0, __get_IPSR())
+
+#else
+
+#define trace(type, task, arg)	do { } while (0)
+#define traceIsrEnter()		do { } while (0)
+#define traceIsrExit()		do { } while (0)
+
+#endif
+
+// ID of the running task for trace(), 0 before init()
+#define traceTaskID()	(currentTask != 0 ? currentTask->taskID : 0)
+
+#endif
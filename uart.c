@@ -21,108 +21,211 @@
 #include "lpc17xx.h"
 //#include "type.h"
 #include "uart.h"
+#include "mutex.h"
+#include "semaphore.h"
+#include "ringbuf.h"
+#include "trace.h"
 
 //#ifdef __DBG_ITM
 volatile int ITM_RxBuffer = ITM_RXBUFFER_EMPTY;  /*  CMSIS Debug Input        */
 //#endif
 
 volatile uint32_t UART0Status, UART1Status;
-volatile uint8_t UART0TxEmpty = 1, UART1TxEmpty = 1;
-volatile uint8_t UART0Buffer[BUFSIZE], UART1Buffer[BUFSIZE];
-volatile uint32_t UART0Count = 0, UART1Count = 0;
 
-volatile uint8_t RcvLock0; 
-volatile uint8_t SndLock0; 
-
-volatile uint8_t RcvLock1; 
-volatile uint8_t SndLock1; 
+// per port rings: the ISR produces into Rx and consumes from Tx, tasks
+// do the opposite, so neither side writes the other's index
+uint8_t UARTRxData[2][UART_RX_BUFSIZE];
+uint8_t UARTTxData[2][UART_TX_BUFSIZE];
+ringBuf_t UARTRxRing[2];
+ringBuf_t UARTTxRing[2];
+
+// set while bytes from the Tx ring are in the transmitter; THRE
+// interrupts then keep it going. while clear, UARTTxKick() starts it
+volatile uint8_t UARTTxBusy[2];
+
+// a receiver found the Rx ring empty and sleeps on UARTRxSem
+volatile uint8_t UARTRxWaiting[2];
+osSem_t UARTRxSem[2];
+
+// a blocking sender found the Tx ring full and sleeps on UARTTxSem
+volatile uint8_t UARTTxWaiting[2];
+osSem_t UARTTxSem[2];
+
+// receive counters; written only by the ISR
+uartStats_t UARTStats[2];
+
+// GPDMA transmit: channel n serves port n. A sender claims the port
+// (SETUP) before it builds the LLIs; the queued transfer then waits for
+// the Tx ring to drain and owns the transmitter until it completes
+#define UART_DMA_IDLE		0
+#define UART_DMA_QUEUED		1
+#define UART_DMA_RUNNING	2
+#define UART_DMA_SETUP		3
+
+typedef struct {
+	uint32_t src;
+	uint32_t dst;
+	uint32_t next;
+	uint32_t ctrl;
+} uartDmaLLI_t;
+
+uartDmaLLI_t UARTDmaLLI[2][UART_DMA_MAX_LLI];
+volatile uint8_t UARTDmaState[2];
+volatile uint8_t UARTDmaResult[2];
+uartDmaCallback_t UARTDmaCallback[2];
+
+// a task sleeps on UARTDmaSem in UARTDMAWait()
+volatile uint8_t UARTDmaWaiting[2];
+osSem_t UARTDmaSem[2];
+
+// one sender and one receiver per port; waiters block in the kernel
+// instead of spinning, and a low-priority holder inherits the priority
+// of whoever is waiting for it
+osMutex_t SndMutex[2];
+osMutex_t RcvMutex[2];
 
 volatile int i = 0;
 
-void Free(volatile uint8_t *tbl){
-	*tbl = 0;
-}
 
-uint8_t Lock(volatile uint8_t *tbl){
-	// Get the lock status and see if it is already locked
-	if (__LDREXW(tbl) == 0) {
-		// if not locked, try set lock to 1
-		return  (__STREXW(1, tbl) != 0) ;
-	} else {
-		return(1); // return fail status
-	}
+static LPC_UART_TypeDef *UARTRegs( uint32_t portNum )
+{
+	return (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
 }
 
-uint8_t LockRcv(uint8_t portNum){
-	if(portNum > 1)
-		return 0x1;
-	return Lock(portNum == 0? &RcvLock0 : &RcvLock1);
-}
+/* move up to a FIFO's worth of bytes from the Tx ring to the transmitter;
+   returns 0 if the ring was empty */
+static uint8_t UARTTxFill( uint32_t portNum, LPC_UART_TypeDef *LPC_UART )
+{
+	uint8_t c;
+	uint32_t n;
 
-uint8_t LockSnd(uint8_t portNum){
-	if(portNum > 1)
-		return 0x1;
-	return Lock(portNum == 0? &SndLock0 : &SndLock1);
+	for ( n = 0; n < UART_TX_FIFO_SIZE; n++ )
+	{
+		if ( !ringGet(&UARTTxRing[portNum], &c) )
+			break;
+		LPC_UART->THR = c;
+	}
+	return (n != 0);
 }
 
-void FreeRcv(uint8_t portNum){
-	if(portNum > 1)
-		return;
-	Free( portNum == 0? &RcvLock0 : &RcvLock1 );
+static LPC_GPDMACH_TypeDef *UARTDmaChannel( uint32_t portNum )
+{
+	return (portNum == 0 ? LPC_GPDMACH0 : LPC_GPDMACH1 );
 }
 
-void FreeSnd(uint8_t portNum){
-	if(portNum > 1)
-		return;
-	Free( portNum == 0? &SndLock0 : &SndLock1 );
+/* hand the transmitter to the queued DMA transfer; called with the
+   transmitter idle and either in the ISR or with interrupts off */
+static void UARTDmaStart( uint32_t portNum )
+{
+	LPC_GPDMACH_TypeDef *ch = UARTDmaChannel(portNum);
+	uartDmaLLI_t *lli = &UARTDmaLLI[portNum][0];
+
+	UARTTxBusy[portNum] = 1;
+	UARTDmaState[portNum] = UART_DMA_RUNNING;
+
+	LPC_GPDMA->IntTCClear = 1UL << portNum;
+	LPC_GPDMA->IntErrClr = 1UL << portNum;
+	ch->DMACCSrcAddr = lli->src;
+	ch->DMACCDestAddr = lli->dst;
+	ch->DMACCLLI = lli->next;
+	ch->DMACCControl = lli->ctrl;
+	/* memory to UARTn Tx (request line 8 + 2n), error and TC interrupts */
+	ch->DMACCConfig = 0x01 | ((8 + 2 * portNum) << 6) | (1UL << 11) | (1UL << 14) | (1UL << 15);
 }
 
-
 /*****************************************************************************
-** Function name:		UART0_IRQHandler
+** Function name:		UARTIRQ
 **
-** Descriptions:		UART0 interrupt handler
+** Descriptions:		Interrupt work shared by both ports: drain the
+**						receive FIFO into the Rx ring and refill the
+**						transmit FIFO from the Tx ring
 **
-** parameters:			None
+** parameters:			portNum
 ** Returned value:		None
 ** 
 *****************************************************************************/
-void UART0_IRQHandler (void) 
+static void UARTIRQ( uint32_t portNum )
 {
-	uint8_t IIRValue, LSRValue;
+	LPC_UART_TypeDef *LPC_UART = UARTRegs(portNum);
+	uartStats_t *stats = &UARTStats[portNum];
+	uint8_t IIRValue, LSRValue, c;
+
+	/* trace.c leaves out what happens here on the trace port */
+	traceIsrEnter();
 
-	IIRValue = LPC_UART0->IIR;
+	IIRValue = LPC_UART->IIR;
 
 	IIRValue >>= 1;			/* skip pending bit in IIR */
 	IIRValue &= 0x07;			/* check bit 1~3, interrupt identification */
 
-	LSRValue = LPC_UART0->LSR;
-
-	if ( LSRValue & LSR_RDR )	/* Receive Data Ready */	
+	/* Receive Line Status, Receive Data Ready or character time-out:
+	   empty the FIFO. The error bits in LSR belong to the character at
+	   the head of the FIFO and reading LSR clears them, so it is read
+	   once per character; that also clears an RLS interrupt. A full
+	   ring drops the newest byte rather than everything buffered. */
+	/* Note: read RBR will clear the interrupt */
+	for ( ;; )
 	{
-		/* If no error on RLS, normal ready, save into the data buffer. */
-		/* Note: read RBR will clear the interrupt */
-		UART0Buffer[UART0Count] = LPC_UART0->RBR;
-		UART0Count++;
-		if ( UART0Count == BUFSIZE )
+		LSRValue = LPC_UART->LSR;
+		if ( LSRValue & LSR_OE )
+			stats->overruns++;
+		if ( !(LSRValue & LSR_RDR) )
+			break;
+		c = LPC_UART->RBR;
+		stats->rxBytes++;
+		if ( LSRValue & (LSR_PE|LSR_FE|LSR_BI) )
 		{
-		UART0Count = 0;		/* buffer overflow */
+			if ( LSRValue & LSR_BI )
+				stats->breaks++;
+			else if ( LSRValue & LSR_FE )
+				stats->framing++;
+			else
+				stats->parity++;
+			continue;
 		}
+		if ( !ringPut(&UARTRxRing[portNum], c) )
+			stats->dropped++;
+	}
+	if ( UARTRxWaiting[portNum] && ringCount(&UARTRxRing[portNum]) != 0 )
+	{
+		UARTRxWaiting[portNum] = 0;
+		osSemSignal(&UARTRxSem[portNum]);
 	}
 
-	if ( IIRValue == IIR_THRE )	/* THRE, transmit holding register empty */
+	/* the DMA owns the transmitter until DMA_IRQHandler hands it back;
+	   a port still in SETUP is not queued yet and counts as idle */
+	if ( IIRValue == IIR_THRE && UARTDmaState[portNum] != UART_DMA_RUNNING )
 	{
-	/* THRE interrupt */
-		LSRValue = LPC_UART0->LSR;		/* Check status in the LSR to see if
-									valid data in U0THR or not */
-		if ( LSRValue & LSR_THRE ){
-			UART0TxEmpty = 1;
+		if ( !UARTTxFill(portNum, LPC_UART) )
+		{
+			if ( UARTDmaState[portNum] == UART_DMA_QUEUED )
+				UARTDmaStart(portNum);
+			else
+				UARTTxBusy[portNum] = 0;
 		}
-		else{
-			UART0TxEmpty = 0;
+		/* wake a blocked sender once there is room for a good chunk */
+		if ( UARTTxWaiting[portNum] && ringSpace(&UARTTxRing[portNum]) >= UART_TX_BUFSIZE / 2 )
+		{
+			UARTTxWaiting[portNum] = 0;
+			osSemSignal(&UARTTxSem[portNum]);
 		}
 	}
 
+	traceIsrExit();
+}
+
+/*****************************************************************************
+** Function name:		UART0_IRQHandler
+**
+** Descriptions:		UART0 interrupt handler
+**
+** parameters:			None
+** Returned value:		None
+** 
+*****************************************************************************/
+void UART0_IRQHandler (void) 
+{
+	UARTIRQ(0);
 }
 
 /*****************************************************************************
@@ -136,40 +239,7 @@ void UART0_IRQHandler (void)
 *****************************************************************************/
 void UART1_IRQHandler (void) 
 {
-
-	uint8_t IIRValue, LSRValue;
-
-	IIRValue = LPC_UART1->IIR;
-
-	IIRValue >>= 1;			/* skip pending bit in IIR */
-	IIRValue &= 0x07;			/* check bit 1~3, interrupt identification */
-
-	LSRValue = LPC_UART1->LSR;
-
-	if ( LSRValue & LSR_RDR )	/* Receive Data Ready */	
-	{
-		/* If no error on RLS, normal ready, save into the data buffer. */
-		/* Note: read RBR will clear the interrupt */
-		UART1Buffer[UART1Count] = LPC_UART1->RBR;
-		UART1Count++;
-		if ( UART1Count == BUFSIZE ){
-		UART0Count = 0;		/* buffer overflow */
-		}
-	}
-
-	if ( IIRValue == IIR_THRE )	/* THRE, transmit holding register empty */
-	{
-	/* THRE interrupt */
-		LSRValue = LPC_UART1->LSR;		/* Check status in the LSR to see if
-									valid data in U0THR or not */
-		if ( LSRValue & LSR_THRE ){
-			UART1TxEmpty = 1;
-		}
-		else{
-			UART1TxEmpty = 0;
-		}
-	}
-
+	UARTIRQ(1);
 }
 
 /* By default, the PCLKSELx value is zero, thus, the PCLK for
@@ -198,6 +268,22 @@ uint32_t getFrequency(uint32_t clk_slct){
 	return pclk;
 }
 
+static void UARTInitBuffers( uint32_t portNum )
+{
+	ringInit(&UARTRxRing[portNum], UARTRxData[portNum], UART_RX_BUFSIZE);
+	ringInit(&UARTTxRing[portNum], UARTTxData[portNum], UART_TX_BUFSIZE);
+	UARTTxBusy[portNum] = 0;
+	UARTRxWaiting[portNum] = 0;
+	osSemInit(&UARTRxSem[portNum], 0);
+	UARTTxWaiting[portNum] = 0;
+	osSemInit(&UARTTxSem[portNum], 0);
+	UARTDmaWaiting[portNum] = 0;
+	osSemInit(&UARTDmaSem[portNum], 0);
+	UARTClearStats(portNum);
+	osMutexInit(&RcvMutex[portNum]);
+	osMutexInit(&SndMutex[portNum]);
+}
+
 /*****************************************************************************
 ** Function name:		UARTInit
 **
@@ -230,15 +316,13 @@ uint32_t UARTInit( uint32_t PortNum, uint32_t baudrate )
 		LPC_UART0->DLL = Fdiv % 256;
 
 		LPC_UART0->LCR = 0x03;		/* DLAB = 0 */
-		LPC_UART0->FCR = 0x07;		/* Enable and reset TX and RX FIFO. */
+		LPC_UART0->FCR = 0x0F;		/* Enable and reset TX and RX FIFO, DMA mode. */
 
+		UARTInitBuffers(0);
 	 	NVIC_EnableIRQ(UART0_IRQn);
 
-		//LPC_UART0->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART0 interrupt */
-		//LPC_UART0->IER =  IER_THRE ;//| IER_RLS;			/* Disable RBR */
+		LPC_UART0->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART0 interrupt */
 
-		FreeRcv(0);
-		FreeSnd(0);
 		return (TRUE);
 	}
 	else if ( PortNum == 1 )
@@ -258,75 +342,108 @@ uint32_t UARTInit( uint32_t PortNum, uint32_t baudrate )
 		LPC_UART1->DLL = Fdiv % 256;
 
 		LPC_UART1->LCR = 0x03;		/* DLAB = 0 */
-		LPC_UART1->FCR = 0x07;		/* Enable and reset TX and RX FIFO. */
+		LPC_UART1->FCR = 0x0F;		/* Enable and reset TX and RX FIFO, DMA mode. */
 
+		UARTInitBuffers(1);
 	 	NVIC_EnableIRQ(UART1_IRQn);
 
-		//LPC_UART1->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART1 interrupt */
-
-		FreeRcv(1);
-		FreeSnd(1);
+		LPC_UART1->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART1 interrupt */
 
 		return (TRUE);
 	}
 	return( FALSE ); 
 }
 
+/*****************************************************************************
+** Function name:		UARTTxKick
+**
+** Descriptions:		Start the transmitter if it is idle. While it is
+**						busy only the ISR takes from the Tx ring; while
+**						it is idle only this does, with interrupts off
+**
+** parameters:			portNum
+** Returned value:		None
+** 
+*****************************************************************************/
+static void UARTTxKick( uint32_t portNum )
+{
+	uint32_t primask = enterCritical();
+
+	if ( !UARTTxBusy[portNum] && UARTTxFill(portNum, UARTRegs(portNum)) )
+		UARTTxBusy[portNum] = 1;
+	exitCritical(primask);
+}
+
 /*****************************************************************************
 ** Function name:		UARTSend
 **
-** Descriptions:		Send a block of data to the UART 0 port based
-**						on the data length
+** Descriptions:		Queue a block of data for the UART 0-1 port and
+**						return without waiting for it to go out; the
+**						THRE interrupt sends it
 **
 ** parameters:			portNum, buffer pointer, and data length
-** Returned value:		None
+** Returned value:		number of bytes queued; less than Length when the
+**						Tx ring is full
 ** 
 *****************************************************************************/
 
-void UARTSend( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+uint32_t UARTSend( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
 {
-	LPC_UART_TypeDef *LPC_UART;
-	volatile unsigned char *UARTTxEmpty;				//ASK Douglas
-	uint8_t *localBufferPtr;
-	uint32_t localLength;
+	uint32_t n;
 
 	if((portNum >> 1 ) != 0)
-		return;
+		return 0;
 
-	localLength = Length;
-	localBufferPtr = BufferPtr;
-	UARTTxEmpty = (portNum == 0 ? &UART0TxEmpty : &UART1TxEmpty);
-	LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
+	osMutexLock(&SndMutex[portNum], OS_WAIT_FOREVER);
+	n = ringWrite(&UARTTxRing[portNum], BufferPtr, Length);
+	UARTTxKick(portNum);
+	osMutexUnlock(&SndMutex[portNum]);
 
-	//Enable interupt
-	LPC_UART->IER |=  IER_THRE;
+	return n;
+}
 
-	while( LockSnd(portNum));
+/*****************************************************************************
+** Function name:		UARTSendBlocking
+**
+** Descriptions:		Queue all of a block of data for the UART 0-1 port,
+**						sleeping while the Tx ring is full. The block is
+**						not interleaved with other senders
+**
+** parameters:			portNum, buffer pointer, and data length
+** Returned value:		None
+** 
+*****************************************************************************/
 
-	while ( localLength != 0 ){
-		/* THRE status, contain valid data */
-		while ( !(*UARTTxEmpty & 0x01) );
-		LPC_UART->THR = *localBufferPtr;
-		*UARTTxEmpty = 0;	/* not empty in the THR until it shifts out */
-		localBufferPtr++;
-		localLength--;
-	}
+void UARTSendBlocking( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+{
+	uint32_t n;
 
-	FreeSnd(portNum);
+	if((portNum >> 1 ) != 0)
+		return;
 
-	//Reanble other interpts
-	LPC_UART->IER &= ~IER_THRE;
+	osMutexLock(&SndMutex[portNum], OS_WAIT_FOREVER);
 
-	return;
+	while ( Length != 0 ){
+		n = ringWrite(&UARTTxRing[portNum], BufferPtr, Length);
+		BufferPtr += n;
+		Length -= n;
+		UARTTxKick(portNum);
+
+		/* before init() there is nobody to switch to, so just spin */
+		if ( Length != 0 && currentTask != 0 ){
+			UARTTxWaiting[portNum] = 1;
+			if ( ringSpace(&UARTTxRing[portNum]) == 0 )
+				osSemWait(&UARTTxSem[portNum], OS_WAIT_FOREVER);
+		}
+	}
+
+	osMutexUnlock(&SndMutex[portNum]);
 }
 
 void UARTSendChar( uint32_t portNum, uint8_t character)
 {
 	#ifdef __RTGT_UART
-		LPC_UART_TypeDef *LPC_UART;
-		LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
-		while (!(LPC_UART->LSR & 0x20));
-		LPC_UART->THR = character;
+		UARTSendBlocking(portNum, &character, 1);
 	#else
 		ITM_SendChar(character);
 	#endif
@@ -335,56 +452,222 @@ void UARTSendChar( uint32_t portNum, uint8_t character)
 
 
 /*****************************************************************************
-** Function name:		UARTRecieve
+** Function name:		DMA_IRQHandler
 **
-** Descriptions:		Recieve a block of data to the UART 0-1 port based
-**						on the data length
+** Descriptions:		GPDMA interrupt handler: finish a UART transmit,
+**						give the transmitter back to the Tx ring and
+**						tell whoever is waiting
 **
-** parameters:			portNum, buffer pointer, and data length
-** Returned value:		integer showing status
+** parameters:			None
+** Returned value:		None
 ** 
 *****************************************************************************/
-uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+void DMA_IRQHandler (void)
+{
+	uint32_t portNum, bit, tc, err;
+
+	traceIsrEnter();
+	tc = LPC_GPDMA->IntTCStat;
+	err = LPC_GPDMA->IntErrStat;
+
+	for ( portNum = 0; portNum < 2; portNum++ )
+	{
+		bit = 1UL << portNum;
+		if ( !((tc | err) & bit) )
+			continue;
+		LPC_GPDMA->IntTCClear = bit;
+		LPC_GPDMA->IntErrClr = bit;
+
+		UARTDmaResult[portNum] = !(err & bit);
+		UARTDmaState[portNum] = UART_DMA_IDLE;
+
+		/* the last bytes may still be in the FIFO; if so, the THRE
+		   interrupt restarts the ring once they are out */
+		if ( UARTRegs(portNum)->LSR & LSR_THRE )
+		{
+			if ( !UARTTxFill(portNum, UARTRegs(portNum)) )
+				UARTTxBusy[portNum] = 0;
+		}
+
+		if ( UARTDmaCallback[portNum] )
+			UARTDmaCallback[portNum](portNum, UARTDmaResult[portNum]);
+		if ( UARTDmaWaiting[portNum] )
+		{
+			UARTDmaWaiting[portNum] = 0;
+			osSemSignal(&UARTDmaSem[portNum]);
+		}
+	}
+	traceIsrExit();
+}
+
+/* give back a port claimed by UARTSendDMAList that ended up sending
+   nothing; a task may have gone to sleep in UARTDMAWait meanwhile */
+static void UARTDmaRelease( uint32_t portNum )
 {
+	uint32_t primask;
+
+	primask = enterCritical();
+	UARTDmaState[portNum] = UART_DMA_IDLE;
+	if ( UARTDmaWaiting[portNum] )
+	{
+		UARTDmaWaiting[portNum] = 0;
+		osSemSignal(&UARTDmaSem[portNum]);
+	}
+	exitCritical(primask);
+}
 
-	LPC_UART_TypeDef *LPC_UART;
-	volatile uint32_t *UARTCount;				//ASK Douglas
-	volatile uint8_t *UARTBuffer;
-	uint8_t *rcvdBufferPtr;
-	uint32_t rcvd_len, i;
+/*****************************************************************************
+** Function name:		UARTSendDMAList
+**
+** Descriptions:		Send a list of buffers on the UART 0-1 port with
+**						the GPDMA, in place and without copying. Returns
+**						at once; the buffers belong to the DMA until the
+**						callback runs or UARTDMAWait() returns. They must
+**						be in memory the GPDMA can reach
+**
+** parameters:			portNum, segment array, segment count, and a
+**						completion callback (may be 0)
+** Returned value:		true if the transfer was queued, false if the
+**						port already has one in flight or the list needs
+**						more than UART_DMA_MAX_LLI items
+** 
+*****************************************************************************/
+uint32_t UARTSendDMAList( uint32_t portNum, const uartDmaSeg_t *Segs, uint32_t Count, uartDmaCallback_t callback )
+{
+	uartDmaLLI_t *lli;
+	uint32_t n = 0, len, k, primask;
+	const uint8_t *buf;
 
 	if((portNum >> 1 ) != 0)
-		return 0;
+		return (FALSE);
 
-	rcvd_len = 0x0;
-	rcvdBufferPtr = BufferPtr;
-	UARTCount = (portNum == 0 ? &UART0Count : &UART1Count);
-	UARTBuffer = (portNum == 0 ? UART0Buffer : UART1Buffer);
-	LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
+	/* claim the port before touching its LLIs */
+	primask = enterCritical();
+	if ( UARTDmaState[portNum] != UART_DMA_IDLE ){
+		exitCritical(primask);
+		return (FALSE);
+	}
+	UARTDmaState[portNum] = UART_DMA_SETUP;
+	exitCritical(primask);
+
+	/* split every segment into items of at most 4095 bytes */
+	for ( k = 0; k < Count; k++ ){
+		buf = Segs[k].buf;
+		len = Segs[k].len;
+		while ( len != 0 ){
+			if ( n == UART_DMA_MAX_LLI ){
+				UARTDmaRelease(portNum);
+				return (FALSE);
+			}
+			lli = &UARTDmaLLI[portNum][n++];
+			lli->src = (uint32_t)buf;
+			lli->dst = (uint32_t)&UARTRegs(portNum)->THR;
+			lli->next = 0;
+			/* byte wide, single transfers, source increments */
+			lli->ctrl = (len > 0xFFF ? 0xFFF : len) | (1UL << 26);
+			buf += lli->ctrl & 0xFFF;
+			len -= lli->ctrl & 0xFFF;
+			if ( n > 1 )
+				UARTDmaLLI[portNum][n - 2].next = (uint32_t)lli;
+		}
+	}
+	if ( n == 0 ){
+		UARTDmaRelease(portNum);
+		return (FALSE);
+	}
+	UARTDmaLLI[portNum][n - 1].ctrl |= 1UL << 31;	/* interrupt at the end */
+
+	if ( !(LPC_SC->PCONP & (1UL << 29)) ){
+		LPC_SC->PCONP |= 1UL << 29;		/* power up the GPDMA */
+		LPC_GPDMA->IntTCClear = 0xFF;
+		LPC_GPDMA->IntErrClr = 0xFF;
+		LPC_GPDMA->Config = 0x01;
+		NVIC_EnableIRQ(DMA_IRQn);
+	}
 
-	*UARTCount = 0x0;
+	UARTDmaCallback[portNum] = callback;
+	UARTDmaResult[portNum] = 0;
 
-	//Enable interupt
-	LPC_UART->IER |=  IER_RBR;
+	/* queue it and start now if the transmitter is idle, else the THRE
+	   interrupt starts it once the Tx ring has drained */
+	primask = enterCritical();
+	UARTDmaState[portNum] = UART_DMA_QUEUED;
+	if ( !UARTTxBusy[portNum] )
+		UARTDmaStart(portNum);
+	exitCritical(primask);
 
-	//busy waiting
+	return (TRUE);
+}
 
-	while( *UARTCount == 0 );
+uint32_t UARTSendDMA( uint32_t portNum, const uint8_t *BufferPtr, uint32_t Length, uartDmaCallback_t callback )
+{
+	uartDmaSeg_t seg;
 
+	seg.buf = BufferPtr;
+	seg.len = Length;
+	return UARTSendDMAList(portNum, &seg, 1, callback);
+}
 
-	//This part has to be put in the critical section
-	while(LockRcv(portNum));
+/*****************************************************************************
+** Function name:		UARTDMAWait
+**
+** Descriptions:		Sleep until the port's DMA transfer has finished
+**
+** parameters:			portNum, and timeout in ticks
+** Returned value:		true if the last transfer completed without
+**						error, false on timeout or a bus error
+** 
+*****************************************************************************/
+uint32_t UARTDMAWait( uint32_t portNum, uint32_t timeout )
+{
+	if((portNum >> 1 ) != 0)
+		return (FALSE);
+
+	while ( UARTDmaState[portNum] != UART_DMA_IDLE ){
+		if ( timeout == OS_NO_WAIT )
+			return (FALSE);
+		if ( currentTask == 0 )
+			continue;
+		UARTDmaWaiting[portNum] = 1;
+		if ( UARTDmaState[portNum] != UART_DMA_IDLE && !osSemWait(&UARTDmaSem[portNum], timeout) )
+			return (FALSE);
+	}
+	return UARTDmaResult[portNum];
+}
 
-	//Reanble other interpts
-	LPC_UART->IER &= ~IER_RBR;			/* Disable RBR */
+/*****************************************************************************
+** Function name:		UARTRecieve
+**
+** Descriptions:		Recieve a block of data from the UART 0-1 port.
+**						Sleeps until at least one byte is buffered
+**
+** parameters:			portNum, buffer pointer, and buffer length
+** Returned value:		number of bytes copied, at most Length
+** 
+*****************************************************************************/
+uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+{
+	uint32_t rcvd_len;
 
+	if((portNum >> 1 ) != 0)
+		return 0;
 
-	for(i = 0; i < *UARTCount; ++i)
-		rcvdBufferPtr[rcvd_len++] = UARTBuffer[i];
+	//one receiver at a time; others sleep until it is done
+	osMutexLock(&RcvMutex[portNum], OS_WAIT_FOREVER);
+
+	while ( ringCount(&UARTRxRing[portNum]) == 0 ){
+		if ( currentTask == 0 )
+			continue;
+		/* the ISR signals once it has buffered something; a signal
+		   left over from an earlier wait just goes round again */
+		UARTRxWaiting[portNum] = 1;
+		if ( ringCount(&UARTRxRing[portNum]) == 0 )
+			osSemWait(&UARTRxSem[portNum], OS_WAIT_FOREVER);
+	}
 
-	*UARTCount = 0;
+	rcvd_len = ringRead(&UARTRxRing[portNum], BufferPtr, Length);
 
-	FreeRcv(portNum);
+	osMutexUnlock(&RcvMutex[portNum]);
 
 	return rcvd_len;
 }
@@ -392,20 +675,55 @@ uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
 uint8_t UARTReceiveChar( uint32_t portNum)
 {
 	#ifdef __RTGT_UART
-		/*uint8_t ret[1];
+		uint8_t ret[1];
 		if (UARTRecieve(portNum, ret, 1) == 1)
 			return ret[0];
-		return 0x0;	*/
-		LPC_UART_TypeDef *LPC_UART;
-		LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
-		while (!(LPC_UART->LSR & 0x01));
-		return (LPC_UART->RBR);
+		return 0x0;
 	#else
 		while (ITM_CheckChar() != 1) __NOP();
 		return (ITM_ReceiveChar());
 	#endif
 }
 
+/*****************************************************************************
+** Function name:		UARTGetStats
+**
+** Descriptions:		Copy the receive counters of the UART 0-1 port
+**
+** parameters:			portNum, and where to put them
+** Returned value:		None
+** 
+*****************************************************************************/
+void UARTGetStats( uint32_t portNum, uartStats_t *stats )
+{
+	uint32_t primask;
+
+	if((portNum >> 1 ) != 0)
+		return;
+
+	/* one consistent snapshot; the ISR may be updating them */
+	primask = enterCritical();
+	*stats = UARTStats[portNum];
+	exitCritical(primask);
+}
+
+void UARTClearStats( uint32_t portNum )
+{
+	uint32_t primask;
+
+	if((portNum >> 1 ) != 0)
+		return;
+
+	primask = enterCritical();
+	UARTStats[portNum].rxBytes = 0;
+	UARTStats[portNum].overruns = 0;
+	UARTStats[portNum].framing = 0;
+	UARTStats[portNum].parity = 0;
+	UARTStats[portNum].breaks = 0;
+	UARTStats[portNum].dropped = 0;
+	exitCritical(primask);
+}
+
 /******************************************************************************
 **                            End Of File
 ******************************************************************************/
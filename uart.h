@@ -41,7 +41,44 @@
 #define LSR_TEMT	0x40
 #define LSR_RXFE	0x80
 
-#define BUFSIZE		0x40
+#define UART_TX_FIFO_SIZE	16	/* hardware transmit FIFO */
+
+/* ring sizes per port, powers of two */
+#ifndef UART_RX_BUFSIZE
+#define UART_RX_BUFSIZE		64
+#endif
+#ifndef UART_TX_BUFSIZE
+#define UART_TX_BUFSIZE		128
+#endif
+
+#if (UART_RX_BUFSIZE & (UART_RX_BUFSIZE - 1)) || (UART_TX_BUFSIZE & (UART_TX_BUFSIZE - 1))
+#error "UART ring sizes must be powers of two"
+#endif
+
+/* GPDMA linked-list items per port for UARTSendDMA; each carries up to
+   4095 bytes of one segment */
+#ifndef UART_DMA_MAX_LLI
+#define UART_DMA_MAX_LLI	4
+#endif
+
+/* one piece of a scatter-gather transmit; the buffer is sent in place */
+typedef struct {
+	const uint8_t *buf;
+	uint32_t len;
+} uartDmaSeg_t;
+
+/* called from DMA_IRQHandler when a transfer ends; ok is 0 on a bus error */
+typedef void (*uartDmaCallback_t)(uint32_t portNum, uint32_t ok);
+
+/* per port receive counters, kept by the UART interrupt handler */
+typedef struct {
+	uint32_t rxBytes;	/* characters read from the receiver */
+	uint32_t overruns;	/* LSR_OE: the hardware FIFO overflowed */
+	uint32_t framing;	/* LSR_FE: bad stop bit, character discarded */
+	uint32_t parity;	/* LSR_PE: parity error, character discarded */
+	uint32_t breaks;	/* LSR_BI: break condition, character discarded */
+	uint32_t dropped;	/* good characters lost because the Rx ring was full */
+} uartStats_t;
 
 #ifndef FALSE
 #define FALSE   (0)
@@ -54,15 +91,23 @@
 
 void UART0_IRQHandler( void );
 void UART1_IRQHandler( void );
+void DMA_IRQHandler( void );
 
 uint32_t UARTInit( uint32_t portNum, uint32_t Baudrate );
 
-void     UARTSend(    uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
+uint32_t UARTSend(    uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
+void     UARTSendBlocking( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
+uint32_t UARTSendDMA( uint32_t portNum, const uint8_t *BufferPtr, uint32_t Length, uartDmaCallback_t callback );
+uint32_t UARTSendDMAList( uint32_t portNum, const uartDmaSeg_t *Segs, uint32_t Count, uartDmaCallback_t callback );
+uint32_t UARTDMAWait( uint32_t portNum, uint32_t timeout );
 uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
 
 void     UARTSendChar(    uint32_t portNum, uint8_t character );
 uint8_t  UARTReceiveChar( uint32_t portNum );
 
+void     UARTGetStats( uint32_t portNum, uartStats_t *stats );
+void     UARTClearStats( uint32_t portNum );
+
 #endif /* end __UART_H */
 /*****************************************************************************
 **                            End Of File
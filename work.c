@@ -0,0 +1,82 @@
+/*
+ * Deferred work: interrupt handlers hand the slow part of their job to
+ * a run-to-completion task at RTOS_WORK_PRIORITY. Submitting pushes the
+ * item onto a list with LDREX/STREX, so it never disables interrupts
+ * and nested handlers may submit at the same time; the worker takes the
+ * whole list in one swap and runs it in submission order.
+ */
+
+#include "work.h"
+
+static osWork_t *volatile workList = 0;	// newest first
+static uint8_t workTaskID = 0;
+
+static void workRun(void *args){
+	osWork_t *list, *w;
+	osWork_t *fifo = 0;
+
+	do {
+		list = (osWork_t *)__LDREXW((volatile uint32_t *)&workList);
+	} while (__STREXW(0, (volatile uint32_t *)&workList));
+
+	// reverse into submission order
+	while (list != 0) {
+		w = list;
+		list = list->next;
+		w->next = fifo;
+		fifo = w;
+	}
+
+	while (fifo != 0) {
+		w = fifo;
+		fifo = fifo->next;
+		// from here on a new submission queues it again
+		w->pending = 0;
+		w->func(w->arg);
+	}
+}
+
+// create the worker; call after init(). returns its task ID, 0 if it
+// could not be created
+uint8_t osWorkStart(void){
+	if (workTaskID == 0) {
+		workTaskID = createTask(workRun, 0, RTOS_WORK_PRIORITY, 0,
+			RTOS_WORK_STACK_SIZE, RTOS_TASK_RUN_TO_COMPLETION);
+		// run whatever was submitted before there was a worker
+		if (workTaskID != 0 && workList != 0)
+			activateTask(workTaskID);
+	}
+	return workTaskID;
+}
+
+void osWorkInit(osWork_t *work, osWorkFunc_t func, void *arg){
+	work->next = 0;
+	work->func = func;
+	work->arg = arg;
+	work->pending = 0;
+}
+
+// queue work to run in the worker task; safe to call from interrupt
+// handlers. returns 0 if it was already queued, in which case it still
+// runs once
+uint8_t osWorkSubmit(osWork_t *work){
+	osWork_t *head;
+
+	do {
+		if (__LDREXW(&work->pending)) {
+			__CLREX();
+			return 0;
+		}
+	} while (__STREXW(1, &work->pending));
+
+	do {
+		head = (osWork_t *)__LDREXW((volatile uint32_t *)&workList);
+		work->next = head;
+	} while (__STREXW((uint32_t)work, (volatile uint32_t *)&workList));
+
+	// a list that was already non-empty has a worker run coming, which
+	// takes this item along
+	if (head == 0 && workTaskID != 0)
+		activateTask(workTaskID);
+	return 1;
+}
@@ -0,0 +1,24 @@
+/*
+ * deferred work header file
+ */
+#ifndef __work_h
+#define __work_h
+
+#include <stdint.h>
+#include "rtos.h"
+
+typedef void (*osWorkFunc_t)(void *arg);
+
+// owned by whoever submits it, usually a static next to the ISR
+typedef struct osWork {
+	struct osWork *next;
+	osWorkFunc_t func;
+	void *arg;
+	volatile uint32_t pending;	// queued and not yet started
+} osWork_t;
+
+uint8_t osWorkStart(void);
+void osWorkInit(osWork_t *work, osWorkFunc_t func, void *arg);
+uint8_t osWorkSubmit(osWork_t *work);
+
+#endif